@@ -1,14 +1,187 @@
-#include "Util.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "ykcmp.h"
 #include "lz4.h"
 
-struct YKCMP_HDR {
-    char magic[8];
-    u32 compType;
-    u32 compSize;
-    u32 decompSize;
-};
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
 
-extern "C" __declspec(dllexport)
+// The fast loop copies in whole 8/16-byte chunks and may touch up to this many bytes past the
+// end of a token, so it only runs while both cursors are at least a full token plus this slack
+// away from the end of their buffers. Everything closer is handled by the exact tail loop.
+constexpr size_t WILDCOPY_OVERLENGTH = 16;
+constexpr size_t TYPE4_IN_MARGIN = 1 + TYPE4_MAX_LITERAL + WILDCOPY_OVERLENGTH;
+constexpr size_t TYPE4_OUT_MARGIN = TYPE4_MAX_MATCH + WILDCOPY_OVERLENGTH;
+
+/// Copies [src, src + (dst_end - dst)) rounded up to 8 bytes. src must be at least 8 bytes behind dst.
+static inline void WildCopy8(u8* dst, const u8* src, const u8* dst_end) {
+    do {
+        memcpy(dst, src, 8);
+        dst += 8; src += 8;
+    } while (dst < dst_end);
+}
+
+/// Copies [src, src + (dst_end - dst)) rounded up to 16 bytes. src must be at least 16 bytes behind dst.
+static inline void WildCopy16(u8* dst, const u8* src, const u8* dst_end) {
+    do {
+        memcpy(dst, src, 16);
+        dst += 16; src += 16;
+    } while (dst < dst_end);
+}
+
+/// PATTERN_SHUFFLE[offset][i] == i % offset, i.e. the byte shuffle that repeats an offset-byte
+/// sequence across a 16-byte register.
+constexpr std::array<std::array<u8, 16>, 16> MakePatternShuffle() {
+    std::array<std::array<u8, 16>, 16> table{};
+    for (u32 offset = 1; offset < 16; ++offset) {
+        for (u32 i = 0; i < 16; ++i) {
+            table[offset][i] = static_cast<u8>(i % offset);
+        }
+    }
+    return table;
+}
+alignas(16) constexpr auto PATTERN_SHUFFLE = MakePatternShuffle();
+
+/// Fills [dst, dst + size) by repeating the offset bytes before dst, as an overlapping
+/// back-reference does. May write up to 16 bytes past dst + size; offset must be in [1, 15].
+static inline void CopyRepeatingPattern(u8* dst, u32 offset, u32 size) {
+    const u8* src = dst - offset;
+    const u8* dst_end = dst + size;
+    alignas(16) u8 pattern[16];
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+    const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(PATTERN_SHUFFLE[offset].data()));
+    _mm_store_si128(reinterpret_cast<__m128i*>(pattern),
+                    _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), mask));
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    vst1q_u8(pattern, vqtbl1q_u8(vld1q_u8(src), vld1q_u8(PATTERN_SHUFFLE[offset].data())));
+#else
+    for (u32 i = 0; i < 16; ++i) {
+        pattern[i] = src[PATTERN_SHUFFLE[offset][i]];
+    }
+#endif
+
+    // Advance by the largest multiple of offset that fits in 16 so every store starts in phase.
+    const u32 step = 16 - (16 % offset);
+    do {
+        memcpy(dst, pattern, 16);
+        dst += step;
+    } while (dst < dst_end);
+}
+
+/// Copies a back-reference of size bytes starting offset bytes behind dst, with the byte-by-byte
+/// forward semantics the format expects when offset < size. May write up to 16 bytes past dst + size.
+static inline void CopyMatch(u8* dst, u32 offset, u32 size) {
+    const u8* src = dst - offset;
+    u8 v[8];
+
+    switch (offset) {
+        case 1:
+            memset(dst, *src, size);
+            return;
+        case 2:
+            memcpy(v, src, 2);
+            memcpy(&v[2], v, 2);
+            memcpy(&v[4], v, 4);
+            break;
+        case 4:
+            memcpy(v, src, 4);
+            memcpy(&v[4], v, 4);
+            break;
+        case 8:
+            memcpy(v, src, 8);
+            break;
+        default:
+            if (offset >= 16) {
+                WildCopy16(dst, src, dst + size);
+            } else if (offset > 8) {
+                WildCopy8(dst, src, dst + size);
+            } else {
+                CopyRepeatingPattern(dst, offset, size);
+            }
+            return;
+    }
+
+    const u8* dst_end = dst + size;
+    do {
+        memcpy(dst, v, 8);
+        dst += 8;
+    } while (dst < dst_end);
+}
+
+/// Decodes a type 4 payload. With SAFE set every token is validated against in_size, out_size and
+/// the bytes produced so far; the checks the fast loop's margins already imply are skipped, so only
+/// the offset test is added there. With PARTIAL set (which implies SAFE) out_size is only how much
+/// of the output is wanted: the token crossing it is cut short and decoding stops there.
+template <bool SAFE, bool PARTIAL = false>
+static s32 DecompressType4(const u8* fd, size_t in_size, u8* out, size_t out_size) {
+    size_t inPos = sizeof(YKCMP_HDR), outPos = 0;
+
+    // Fast loop: every token fits with slack to spare, so copies can over-read and over-write.
+    while (inPos + TYPE4_IN_MARGIN <= in_size && outPos + TYPE4_OUT_MARGIN <= out_size) {
+        u8 control = fd[inPos++];
+
+        if (control < 0x80) {
+            WildCopy16(&out[outPos], &fd[inPos], &out[outPos + control]);
+            outPos += control; inPos += control;
+            continue;
+        }
+
+        u32 offset, size;
+        DecodeType4Match(control, fd, inPos, offset, size);
+
+        if (SAFE && offset > outPos) return YKCMP_ERROR_OFFSET;
+
+        CopyMatch(&out[outPos], offset, size);
+        outPos += size;
+    }
+
+    // Tail loop: exact copies only.
+    while (inPos < in_size) {
+        if (PARTIAL && outPos == out_size) break;
+
+        u8 control = fd[inPos++];
+
+        //printf("%08X control 0x%02X\n", inPos - 1, control);
+
+        if (control < 0x80) {
+            if (SAFE) {
+                if (control > in_size - inPos) return YKCMP_ERROR_INPUT_OVERRUN;
+                if (PARTIAL && control > out_size - outPos) control = static_cast<u8>(out_size - outPos);
+                if (control > out_size - outPos) return YKCMP_ERROR_OUTPUT_OVERRUN;
+            }
+            memcpy(&out[outPos], &fd[inPos], control);
+            outPos += control; inPos += control;
+        } else {
+            if (SAFE && Type4ExtraBytes(control) > in_size - inPos) return YKCMP_ERROR_INPUT_OVERRUN;
+
+            u32 offset, size;
+            DecodeType4Match(control, fd, inPos, offset, size);
+
+            if (SAFE) {
+                if (offset > outPos) return YKCMP_ERROR_OFFSET;
+                if (PARTIAL && size > out_size - outPos) size = static_cast<u32>(out_size - outPos);
+                if (size > out_size - outPos) return YKCMP_ERROR_OUTPUT_OVERRUN;
+            }
+
+            //printf("size 0x%08X offset 0x%08X output is currently %08X\n\n", size, offset, outPos);
+            for (u32 i = 0; i < size; ++i) {
+                out[outPos + i] = out[outPos + i - offset];
+            }
+            outPos += size;
+        }
+    }
+
+    if (SAFE && outPos != out_size) return YKCMP_ERROR_TRUNCATED;
+
+    return YKCMP_OK;
+}
+
+extern "C" YKCMP_API
 bool decompress(u8* fd, u32 in_size, u8* out, u32 out_size) {
     YKCMP_HDR hdr{};
     memcpy(&hdr, fd, sizeof(YKCMP_HDR));
@@ -19,40 +192,8 @@ bool decompress(u8* fd, u32 in_size, u8* out, u32 out_size) {
 
     switch (hdr.compType) {
         case 4: // custom
-        {
-            size_t inPos = 0x14, outPos = 0;
-
-            while (inPos < in_size) {
-                uint8_t control = fd[inPos++];
-
-                //printf("%08X control 0x%02X\n", inPos - 1, control);
-
-                if (control < 0x80) {
-                    memcpy(&out[outPos], &fd[inPos], control);
-                    outPos += control; inPos += control;
-                } else {
-                    uint32_t offset = 0, size = 0;
-
-                    if (control < 0xC0) {
-                        offset = (control & 0xF) + 1;
-                        size = (control >> 4) - 8 + 1;
-                    } else if (control < 0xE0) {
-                        offset = fd[inPos++] + 1;
-                        size = control - 0xC0 + 2;
-                    } else {
-                        uint8_t temp = fd[inPos++];
-                        uint8_t temp2 = fd[inPos++];
-                        size = (control << 4) + (temp >> 4) - 0xE00 + 3;
-                        offset = ((temp & 0xF) << 8) + temp2 + 1;
-                    }
-
-                    //printf("size 0x%08X offset 0x%08X output is currently %08X\n\n", size, offset, outPos);
-                    memcpy(&out[outPos], &out[outPos - offset], size);
-                    outPos += size;
-                }
-            }
-        }
-        break;
+            DecompressType4<false>(fd, in_size, out, out_size);
+            break;
 
         case 8:
         case 9:
@@ -66,3 +207,66 @@ bool decompress(u8* fd, u32 in_size, u8* out, u32 out_size) {
 
     return true;
 }
+
+static s32 ReadHeader(const u8* fd, u32 in_size, YKCMP_HDR& hdr) {
+    if (in_size < sizeof(YKCMP_HDR)) return YKCMP_ERROR_HEADER;
+    memcpy(&hdr, fd, sizeof(YKCMP_HDR));
+
+    if (memcmp(hdr.magic, YKCMP_MAGIC, sizeof(YKCMP_MAGIC)) != 0) return YKCMP_ERROR_HEADER;
+    return YKCMP_OK;
+}
+
+extern "C" YKCMP_API
+s32 decompress_safe(const u8* fd, u32 in_size, u8* out, u32 out_size) {
+    YKCMP_HDR hdr{};
+    if (const s32 status = ReadHeader(fd, in_size, hdr); status < 0) return status;
+    if (hdr.decompSize != out_size) return YKCMP_ERROR_SIZE_MISMATCH;
+
+    switch (hdr.compType) {
+        case 4:
+            return DecompressType4<true>(fd, in_size, out, out_size);
+
+        case 8:
+        case 9:
+        {
+            const u32 payload_size = std::min<u32>(hdr.compSize, in_size - sizeof(YKCMP_HDR));
+            const int written = LZ4_decompress_safe((const char*)fd + sizeof(YKCMP_HDR), (char*)out,
+                                                    payload_size, out_size);
+            if (written < 0) return YKCMP_ERROR_LZ4;
+            if (static_cast<u32>(written) != out_size) return YKCMP_ERROR_TRUNCATED;
+            return YKCMP_OK;
+        }
+
+        default:
+            return YKCMP_ERROR_TYPE;
+    }
+}
+
+extern "C" YKCMP_API
+s32 decompress_prefix(const u8* fd, u32 in_size, u8* out, u32 want_bytes) {
+    YKCMP_HDR hdr{};
+    if (const s32 status = ReadHeader(fd, in_size, hdr); status < 0) return status;
+    want_bytes = std::min(want_bytes, hdr.decompSize);
+
+    switch (hdr.compType) {
+        case 4:
+        {
+            const s32 status = DecompressType4<true, true>(fd, in_size, out, want_bytes);
+            return status < 0 ? status : static_cast<s32>(want_bytes);
+        }
+
+        case 8:
+        case 9:
+        {
+            const u32 payload_size = std::min<u32>(hdr.compSize, in_size - sizeof(YKCMP_HDR));
+            const int written = LZ4_decompress_safe_partial((const char*)fd + sizeof(YKCMP_HDR), (char*)out,
+                                                            payload_size, want_bytes, want_bytes);
+            if (written < 0) return YKCMP_ERROR_LZ4;
+            if (static_cast<u32>(written) != want_bytes) return YKCMP_ERROR_TRUNCATED;
+            return written;
+        }
+
+        default:
+            return YKCMP_ERROR_TYPE;
+    }
+}
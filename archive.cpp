@@ -0,0 +1,170 @@
+#include <cstring>
+#include "archive.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::vector<YKCMPEntry> FindYKCMPBlobs(const u8* data, u64 size) {
+    std::vector<YKCMPEntry> entries;
+    u64 pos = 0;
+    while (size - pos >= sizeof(YKCMP_HDR)) {
+        const void* found = std::memchr(data + pos, YKCMP_MAGIC[0], size - pos - sizeof(YKCMP_HDR) + 1);
+        if (!found) break;
+        pos = static_cast<const u8*>(found) - data;
+        if (std::memcmp(data + pos, YKCMP_MAGIC, sizeof(YKCMP_MAGIC)) != 0) {
+            ++pos;
+            continue;
+        }
+
+        YKCMP_HDR hdr{};
+        std::memcpy(&hdr, data + pos, sizeof(YKCMP_HDR));
+        // Type 4 counts the header in compSize; the LZ4 types count only the payload after it.
+        u64 span = 0;
+        if (hdr.compType == 4 && hdr.compSize >= sizeof(YKCMP_HDR)) {
+            span = hdr.compSize;
+        } else if (hdr.compType == 8 || hdr.compType == 9) {
+            span = u64{hdr.compSize} + sizeof(YKCMP_HDR);
+        }
+        if (span == 0 || span > size - pos || span > UINT32_MAX) {
+            ++pos;
+            continue;
+        }
+
+        entries.push_back({pos, static_cast<u32>(span), hdr});
+        pos += span;
+    }
+    return entries;
+}
+
+/// Read-only view of a whole file, unmapped on destruction.
+class FileMapping {
+public:
+    FileMapping() = default;
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+    ~FileMapping() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+#else
+        if (data) munmap(const_cast<u8*>(data), size);
+#endif
+    }
+
+    bool Open(const char* path) {
+#ifdef _WIN32
+        const int wide_size = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+        std::vector<wchar_t> wide_path(wide_size);
+        MultiByteToWideChar(CP_UTF8, 0, path, -1, wide_path.data(), wide_size);
+        const HANDLE file = CreateFileW(wide_path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER file_size{};
+        if (!GetFileSizeEx(file, &file_size)) {
+            CloseHandle(file);
+            return false;
+        }
+        size = static_cast<u64>(file_size.QuadPart);
+        if (size == 0) {
+            CloseHandle(file);
+            return true;
+        }
+        const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) return false;
+        data = static_cast<const u8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        return data != nullptr;
+#else
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        size = static_cast<u64>(st.st_size);
+        if (size == 0) {
+            close(fd);
+            return true;
+        }
+        void* const mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+        data = static_cast<const u8*>(mapped);
+        // The index is built by one pass from start to end.
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        return true;
+#endif
+    }
+
+    /// Asks for [offset, offset + length) to be read in ahead of use.
+    void WillNeed(u64 offset, u64 length) const {
+#ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<u8*>(data) + offset, static_cast<SIZE_T>(length)};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        // madvise wants a page-aligned start.
+        const u64 page = static_cast<u64>(sysconf(_SC_PAGESIZE));
+        const u64 begin = offset & ~(page - 1);
+        madvise(const_cast<u8*>(data) + begin, offset + length - begin, MADV_WILLNEED);
+#endif
+    }
+
+    const u8* data = nullptr;
+    u64 size = 0;
+};
+
+struct YKCMPArchive {
+    FileMapping file;
+    std::vector<YKCMPEntry> entries;
+};
+
+extern "C" YKCMP_API
+YKCMPArchive* archive_open(const char* path) {
+    auto* const archive = new YKCMPArchive();
+    if (!archive->file.Open(path)) {
+        delete archive;
+        return nullptr;
+    }
+    archive->entries = FindYKCMPBlobs(archive->file.data, archive->file.size);
+    return archive;
+}
+
+extern "C" YKCMP_API
+void archive_close(YKCMPArchive* archive) {
+    delete archive;
+}
+
+extern "C" YKCMP_API
+u32 archive_entry_count(const YKCMPArchive* archive) {
+    return static_cast<u32>(archive->entries.size());
+}
+
+extern "C" YKCMP_API
+bool archive_entry(const YKCMPArchive* archive, u32 index, YKCMPEntry* entry) {
+    if (index >= archive->entries.size()) return false;
+    *entry = archive->entries[index];
+    return true;
+}
+
+extern "C" YKCMP_API
+const u8* archive_entry_data(const YKCMPArchive* archive, u32 index) {
+    if (index >= archive->entries.size()) return nullptr;
+    return archive->file.data + archive->entries[index].offset;
+}
+
+extern "C" YKCMP_API
+s32 archive_decompress(const YKCMPArchive* archive, u32 index, u8* out, u32 out_size) {
+    if (index >= archive->entries.size()) return YKCMP_ERROR_HEADER;
+    const YKCMPEntry& entry = archive->entries[index];
+    archive->file.WillNeed(entry.offset, entry.size);
+    return decompress_safe(archive->file.data + entry.offset, entry.size, out, out_size);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include "ykcmp.h"
+
+/// One YKCMP blob found inside a container: its header and the bytes it spans, header included.
+struct YKCMPEntry {
+    u64 offset;
+    u32 size;
+    YKCMP_HDR hdr;
+};
+
+/// Finds the YKCMP blobs in a buffer by their magic. A candidate counts only if its compression
+/// type is known and its span fits in the buffer; scanning resumes after each blob, so payload bytes
+/// that happen to spell the magic are not mistaken for another entry.
+std::vector<YKCMPEntry> FindYKCMPBlobs(const u8* data, u64 size);
+
+/// A container file mapped read-only, with the blobs FindYKCMPBlobs found in it.
+struct YKCMPArchive;
+
+extern "C" {
+/// Maps the file at path (UTF-8) and indexes its blobs. Returns nullptr if it can't be opened or
+/// mapped. The mapping stays valid until archive_close.
+YKCMP_API YKCMPArchive* archive_open(const char* path);
+YKCMP_API void archive_close(YKCMPArchive* archive);
+
+YKCMP_API u32 archive_entry_count(const YKCMPArchive* archive);
+/// Copies an entry's description; false if index is out of range.
+YKCMP_API bool archive_entry(const YKCMPArchive* archive, u32 index, YKCMPEntry* entry);
+/// Zero-copy view of an entry's bytes, header included, or nullptr if index is out of range. The
+/// pointer can go straight to decompress_safe, decompress_prefix or DecompressUnswizzleImage.
+YKCMP_API const u8* archive_entry_data(const YKCMPArchive* archive, u32 index);
+
+/// decompress_safe reading straight from the mapping. The entry's pages are requested ahead of the
+/// decoder, which then walks them front to back. out_size must be the entry's decompSize.
+YKCMP_API s32 archive_decompress(const YKCMPArchive* archive, u32 index, u8* out, u32 out_size);
+}
@@ -0,0 +1,821 @@
+// Block decoder for ASTC LDR and sRGB textures with 2D footprints from 4x4 to 12x12, to RGBA8.
+// HDR content, reserved encodings and other illegal blocks decode to the magenta error colour.
+// As with the decode_unorm8 extension, endpoints widen to 16 bits by replication (or by appending
+// 0x80 for sRGB) and the top byte of each interpolated value is kept.
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include "decode.h"
+
+constexpr u32 ASTC_BLOCK_BITS = 128;
+constexpr u32 ASTC_MAX_TEXELS = 144;
+constexpr u32 ASTC_MAX_WEIGHTS = 64;
+constexpr u32 ASTC_MAX_COLOR_VALUES = 18;
+constexpr u32 ASTC_MAX_PARTITIONS = 4;
+constexpr u32 ASTC_PARTITION_SEEDS = 1024;
+constexpr u8 ASTC_ERROR_COLOR[4] = {0xFF, 0x00, 0xFF, 0xFF};
+
+/// 128 bits of a block as a little-endian bit stream. The zero words past the end let reads run
+/// over it without branches.
+struct ASTCBits {
+    u64 words[4]{};
+
+    /// Up to 64 bits from pos, which may be anywhere up to bit 128.
+    u64 Read64(u32 pos) const {
+        const u32 word = pos >> 6;
+        const u32 shift = pos & 63;
+        return (words[word] >> shift) | ((words[word + 1] << 1) << (63 - shift));
+    }
+
+    u32 Read(u32 pos, u32 count) const {
+        return static_cast<u32>(Read64(pos)) & ((1U << count) - 1);
+    }
+
+    /// The count bits from start on their own, with everything after them reading as zero.
+    ASTCBits Slice(u32 start, u32 count) const {
+        ASTCBits slice;
+        slice.words[0] = Read64(start);
+        slice.words[1] = start + 64 <= ASTC_BLOCK_BITS ? Read64(start + 64) : 0;
+        if (count < 64) {
+            slice.words[0] &= (u64{1} << count) - 1;
+            slice.words[1] = 0;
+        } else if (count < 128) {
+            slice.words[1] &= (u64{1} << (count - 64)) - 1;
+        }
+        return slice;
+    }
+
+    /// Weights are stored from bit 127 downwards.
+    ASTCBits Reversed() const {
+        auto reverse = [](u64 v) {
+            v = ((v >> 1) & 0x5555555555555555) | ((v & 0x5555555555555555) << 1);
+            v = ((v >> 2) & 0x3333333333333333) | ((v & 0x3333333333333333) << 2);
+            v = ((v >> 4) & 0x0F0F0F0F0F0F0F0F) | ((v & 0x0F0F0F0F0F0F0F0F) << 4);
+            v = ((v >> 8) & 0x00FF00FF00FF00FF) | ((v & 0x00FF00FF00FF00FF) << 8);
+            v = ((v >> 16) & 0x0000FFFF0000FFFF) | ((v & 0x0000FFFF0000FFFF) << 16);
+            return (v >> 32) | (v << 32);
+        };
+        ASTCBits reversed;
+        reversed.words[0] = reverse(words[1]);
+        reversed.words[1] = reverse(words[0]);
+        return reversed;
+    }
+};
+
+/// One quantisation level of the integer sequence encoding: a run of plain bits per value, plus
+/// a trit or quint packed together with those of the neighbouring values.
+struct ISEEncoding {
+    u8 bits;
+    bool trits;
+    bool quints;
+};
+
+/// Levels by increasing range: 2, 3, 4, 5, 6, 8, 10, 12, 16, 20, 24, 32, 40, 48, 64, 80, 96,
+/// 128, 160, 192 and 256 values.
+constexpr ISEEncoding ISE_ENCODINGS[] = {
+    {1, false, false}, {0, true, false},  {2, false, false}, {0, false, true}, {1, true, false},
+    {3, false, false}, {1, false, true},  {2, true, false},  {4, false, false}, {2, false, true},
+    {3, true, false},  {5, false, false}, {3, false, true},  {4, true, false},  {6, false, false},
+    {4, false, true},  {5, true, false},  {7, false, false}, {5, false, true},  {6, true, false},
+    {8, false, false},
+};
+constexpr u32 ISE_LEVELS = static_cast<u32>(std::size(ISE_ENCODINGS));
+constexpr u32 ISE_WEIGHT_LEVELS = 12; ///< Weights go up to 32 values
+constexpr u32 ISE_LEVEL_6 = 4;        ///< The coarsest level colour endpoints may use
+
+constexpr u32 ISEBits(u32 level, u32 count) {
+    const ISEEncoding& encoding = ISE_ENCODINGS[level];
+    return encoding.bits * count + (encoding.trits ? (count * 8 + 4) / 5 : 0) +
+           (encoding.quints ? (count * 7 + 2) / 3 : 0);
+}
+
+/// Five trits packed into 8 bits.
+constexpr auto TRIT_TABLE = [] {
+    std::array<std::array<u8, 5>, 256> table{};
+    for (u32 packed = 0; packed < 256; ++packed) {
+        u32 c, t3, t4;
+        if (((packed >> 2) & 7) == 7) {
+            c = ((packed >> 5) << 2) | (packed & 3);
+            t3 = t4 = 2;
+        } else {
+            c = packed & 0x1F;
+            if (((packed >> 5) & 3) == 3) {
+                t4 = 2;
+                t3 = packed >> 7;
+            } else {
+                t4 = packed >> 7;
+                t3 = (packed >> 5) & 3;
+            }
+        }
+        u32 t0, t1, t2;
+        if ((c & 3) == 3) {
+            t2 = 2;
+            t1 = c >> 4;
+            t0 = (((c >> 3) & 1) << 1) | ((c >> 2) & ~(c >> 3) & 1);
+        } else if (((c >> 2) & 3) == 3) {
+            t2 = t1 = 2;
+            t0 = c & 3;
+        } else {
+            t2 = c >> 4;
+            t1 = (c >> 2) & 3;
+            t0 = (((c >> 1) & 1) << 1) | (c & ~(c >> 1) & 1);
+        }
+        table[packed] = {static_cast<u8>(t0), static_cast<u8>(t1), static_cast<u8>(t2), static_cast<u8>(t3),
+                         static_cast<u8>(t4)};
+    }
+    return table;
+}();
+
+/// Three quints packed into 7 bits.
+constexpr auto QUINT_TABLE = [] {
+    std::array<std::array<u8, 3>, 128> table{};
+    for (u32 packed = 0; packed < 128; ++packed) {
+        u32 q0, q1, q2;
+        if (((packed >> 1) & 3) == 3 && ((packed >> 5) & 3) == 0) {
+            const u32 q = packed & 1;
+            q2 = (q << 2) | (((packed >> 4) & ~q & 1) << 1) | ((packed >> 3) & ~q & 1);
+            q1 = q0 = 4;
+        } else {
+            u32 c;
+            if (((packed >> 1) & 3) == 3) {
+                q2 = 4;
+                c = (((packed >> 3) & 3) << 3) | ((~packed >> 5 & 3) << 1) | (packed & 1);
+            } else {
+                q2 = (packed >> 5) & 3;
+                c = packed & 0x1F;
+            }
+            if ((c & 7) == 5) {
+                q1 = 4;
+                q0 = c >> 3;
+            } else {
+                q1 = c >> 3;
+                q0 = c & 7;
+            }
+        }
+        table[packed] = {static_cast<u8>(q0), static_cast<u8>(q1), static_cast<u8>(q2)};
+    }
+    return table;
+}();
+
+/// Decodes count values, each returned as its trit or quint above its plain bits. A trit or quint
+/// group is at most 48 bits, so each one comes out of a single 64-bit read.
+static void DecodeISE(const ASTCBits& bits, u32 level, u32 count, u8* values) {
+    const ISEEncoding& encoding = ISE_ENCODINGS[level];
+    const u32 n = encoding.bits;
+    u32 pos = 0;
+    u64 group = 0;
+    auto take = [&](u32 width) {
+        const u32 value = static_cast<u32>(group) & ((1U << width) - 1);
+        group >>= width;
+        return value;
+    };
+
+    if (encoding.trits) {
+        for (u32 i = 0; i < count; i += 5) {
+            group = bits.Read64(pos);
+            pos += n * 5 + 8;
+            u32 low[5];
+            u32 packed = 0;
+            low[0] = take(n);
+            packed |= take(2);
+            low[1] = take(n);
+            packed |= take(2) << 2;
+            low[2] = take(n);
+            packed |= take(1) << 4;
+            low[3] = take(n);
+            packed |= take(2) << 5;
+            low[4] = take(n);
+            packed |= take(1) << 7;
+            for (u32 j = 0; j < 5 && i + j < count; ++j) {
+                values[i + j] = static_cast<u8>((TRIT_TABLE[packed][j] << n) | low[j]);
+            }
+        }
+    } else if (encoding.quints) {
+        for (u32 i = 0; i < count; i += 3) {
+            group = bits.Read64(pos);
+            pos += n * 3 + 7;
+            u32 low[3];
+            u32 packed = 0;
+            low[0] = take(n);
+            packed |= take(3);
+            low[1] = take(n);
+            packed |= take(2) << 3;
+            low[2] = take(n);
+            packed |= take(2) << 5;
+            for (u32 j = 0; j < 3 && i + j < count; ++j) {
+                values[i + j] = static_cast<u8>((QUINT_TABLE[packed][j] << n) | low[j]);
+            }
+        }
+    } else {
+        const u32 per_read = 64 / n;
+        for (u32 i = 0; i < count; i += per_read) {
+            group = bits.Read64(pos);
+            pos += n * per_read;
+            for (u32 j = 0; j < per_read && i + j < count; ++j) {
+                values[i + j] = static_cast<u8>(take(n));
+            }
+        }
+    }
+}
+
+/// Repeats the low bits of value until they fill to_bits.
+constexpr u32 ReplicateBits(u32 value, u32 from_bits, u32 to_bits) {
+    u32 result = 0;
+    for (s32 shift = static_cast<s32>(to_bits - from_bits); shift > -static_cast<s32>(from_bits);
+         shift -= static_cast<s32>(from_bits)) {
+        result |= shift >= 0 ? value << shift : value >> -shift;
+    }
+    return result & ((1U << to_bits) - 1);
+}
+
+/// Colour endpoint values to 0..255, by level and encoded value.
+constexpr auto COLOR_UNQUANTIZE = [] {
+    std::array<std::array<u8, 256>, ISE_LEVELS> table{};
+    for (u32 level = 0; level < ISE_LEVELS; ++level) {
+        const ISEEncoding& encoding = ISE_ENCODINGS[level];
+        const u32 n = encoding.bits;
+        const u32 range = (1U << n) * (encoding.trits ? 3 : encoding.quints ? 5 : 1);
+        for (u32 value = 0; value < range; ++value) {
+            const u32 low = value & ((1U << n) - 1);
+            if (!encoding.trits && !encoding.quints) {
+                table[level][value] = static_cast<u8>(ReplicateBits(low, n, 8));
+                continue;
+            }
+            if (n == 0) continue; // ranges 3 and 5 are too coarse for endpoints
+            const u32 d = value >> n;
+            const u32 a = (low & 1) ? 0x1FF : 0;
+            const u32 x = low >> 1;
+            u32 b = 0;
+            u32 c = 0;
+            if (encoding.trits) {
+                constexpr u32 C[] = {0, 204, 93, 44, 22, 11, 5};
+                c = C[n];
+                switch (n) {
+                    case 2: b = x * 0x116; break;
+                    case 3: b = x * 0x85; break;
+                    case 4: b = x * 0x41; break;
+                    case 5: b = (x << 5) | (x >> 2); break;
+                    case 6: b = (x << 4) | (x >> 4); break;
+                }
+            } else {
+                constexpr u32 C[] = {0, 113, 54, 26, 13, 6};
+                c = C[n];
+                switch (n) {
+                    case 2: b = x * 0x10C; break;
+                    case 3: b = (x << 7) | (x << 1) | (x >> 1); break;
+                    case 4: b = (x << 6) | (x >> 1); break;
+                    case 5: b = (x << 5) | (x >> 3); break;
+                }
+            }
+            const u32 t = (d * c + b) ^ a;
+            table[level][value] = static_cast<u8>((a & 0x80) | (t >> 2));
+        }
+    }
+    return table;
+}();
+
+/// Weight values to 0..64, by level and encoded value.
+constexpr auto WEIGHT_UNQUANTIZE = [] {
+    std::array<std::array<u8, 32>, ISE_WEIGHT_LEVELS> table{};
+    for (u32 level = 0; level < ISE_WEIGHT_LEVELS; ++level) {
+        const ISEEncoding& encoding = ISE_ENCODINGS[level];
+        const u32 n = encoding.bits;
+        const u32 range = (1U << n) * (encoding.trits ? 3 : encoding.quints ? 5 : 1);
+        for (u32 value = 0; value < range; ++value) {
+            const u32 low = value & ((1U << n) - 1);
+            const u32 d = value >> n;
+            u32 result;
+            if (!encoding.trits && !encoding.quints) {
+                result = ReplicateBits(low, n, 6);
+            } else if (n == 0) {
+                constexpr u8 TRITS[] = {0, 32, 63};
+                constexpr u8 QUINTS[] = {0, 16, 32, 47, 63};
+                result = encoding.trits ? TRITS[d] : QUINTS[d];
+            } else {
+                const u32 a = (low & 1) ? 0x7F : 0;
+                const u32 x = low >> 1;
+                u32 b = 0;
+                u32 c;
+                if (encoding.trits) {
+                    constexpr u32 C[] = {0, 50, 23, 11};
+                    c = C[n];
+                    b = n == 2 ? x * 0x45 : n == 3 ? x * 0x21 : 0;
+                } else {
+                    constexpr u32 C[] = {0, 28, 13};
+                    c = C[n];
+                    b = n == 2 ? x * 0x42 : 0;
+                }
+                const u32 t = (d * c + b) ^ a;
+                result = (a & 0x20) | (t >> 2);
+            }
+            table[level][value] = static_cast<u8>(result > 32 ? result + 1 : result);
+        }
+    }
+    return table;
+}();
+
+struct ASTCBlockMode {
+    u8 grid_width;
+    u8 grid_height;
+    u8 weight_level;
+    u8 weight_bits;
+    bool dual_plane;
+    bool valid;
+};
+
+/// Unpacks the 11-bit block mode. Weight grids that break the size limits come back invalid;
+/// whether the grid fits the footprint is left to the caller.
+constexpr ASTCBlockMode MakeBlockMode(u32 mode) {
+    ASTCBlockMode result{};
+    bool dual_plane = (mode >> 10) & 1;
+    bool high_precision = (mode >> 9) & 1;
+    const u32 a = (mode >> 5) & 3;
+    u32 width = 0;
+    u32 height = 0;
+    u32 r;
+    if ((mode & 3) != 0) {
+        r = ((mode >> 4) & 1) | ((mode & 3) << 1);
+        const u32 b = (mode >> 7) & 3;
+        switch ((mode >> 2) & 3) {
+            case 0:
+                width = b + 4;
+                height = a + 2;
+                break;
+            case 1:
+                width = b + 8;
+                height = a + 2;
+                break;
+            case 2:
+                width = a + 2;
+                height = b + 8;
+                break;
+            default:
+                if (mode & 0x100) {
+                    width = (b & 1) + 2;
+                    height = a + 2;
+                } else {
+                    width = a + 2;
+                    height = (b & 1) + 6;
+                }
+                break;
+        }
+    } else {
+        r = ((mode >> 4) & 1) | (((mode >> 2) & 3) << 1);
+        switch ((mode >> 7) & 3) {
+            case 0:
+                width = 12;
+                height = a + 2;
+                break;
+            case 1:
+                width = a + 2;
+                height = 12;
+                break;
+            case 2:
+                width = a + 6;
+                height = ((mode >> 9) & 3) + 6;
+                dual_plane = high_precision = false;
+                break;
+            default:
+                if (a > 1) return result;
+                width = a == 0 ? 6 : 10;
+                height = a == 0 ? 10 : 6;
+                break;
+        }
+    }
+    if (r < 2) return result;
+
+    const u32 level = r - 2 + (high_precision ? 6 : 0);
+    const u32 count = width * height * (dual_plane ? 2 : 1);
+    if (count > ASTC_MAX_WEIGHTS) return result;
+    const u32 bits = ISEBits(level, count);
+    if (bits < 24 || bits > 96) return result;
+
+    result.grid_width = static_cast<u8>(width);
+    result.grid_height = static_cast<u8>(height);
+    result.weight_level = static_cast<u8>(level);
+    result.weight_bits = static_cast<u8>(bits);
+    result.dual_plane = dual_plane;
+    result.valid = true;
+    return result;
+}
+
+constexpr auto ASTC_BLOCK_MODES = [] {
+    std::array<ASTCBlockMode, 2048> modes{};
+    for (u32 mode = 0; mode < 2048; ++mode) {
+        modes[mode] = MakeBlockMode(mode);
+    }
+    return modes;
+}();
+
+static u32 PartitionHash(u32 p) {
+    p ^= p >> 15;
+    p -= p << 17;
+    p += p << 7;
+    p += p << 4;
+    p ^= p >> 5;
+    p += p << 16;
+    p ^= p >> 7;
+    p ^= p >> 3;
+    p ^= p << 6;
+    p ^= p >> 17;
+    return p;
+}
+
+/// The specification's partition pattern generator, for 2D blocks.
+static u32 SelectPartition(u32 seed, u32 x, u32 y, u32 partitions, bool small_block) {
+    if (small_block) {
+        x <<= 1;
+        y <<= 1;
+    }
+    seed += (partitions - 1) * 1024;
+    const u32 rnum = PartitionHash(seed);
+    u8 seeds[8];
+    for (u32 i = 0; i < 8; ++i) {
+        seeds[i] = static_cast<u8>((rnum >> (i * 4)) & 0xF);
+        seeds[i] = static_cast<u8>(seeds[i] * seeds[i]);
+    }
+    u32 sh1, sh2;
+    if (seed & 1) {
+        sh1 = (seed & 2) ? 4 : 5;
+        sh2 = partitions == 3 ? 6 : 5;
+    } else {
+        sh1 = partitions == 3 ? 6 : 5;
+        sh2 = (seed & 2) ? 4 : 5;
+    }
+    const u32 a = ((seeds[0] >> sh1) * x + (seeds[1] >> sh2) * y + (rnum >> 14)) & 0x3F;
+    const u32 b = ((seeds[2] >> sh1) * x + (seeds[3] >> sh2) * y + (rnum >> 10)) & 0x3F;
+    const u32 c = partitions < 3 ? 0 : ((seeds[4] >> sh1) * x + (seeds[5] >> sh2) * y + (rnum >> 6)) & 0x3F;
+    const u32 d = partitions < 4 ? 0 : ((seeds[6] >> sh1) * x + (seeds[7] >> sh2) * y + (rnum >> 2)) & 0x3F;
+    if (a >= b && a >= c && a >= d) return 0;
+    if (b >= c && b >= d) return 1;
+    if (c >= d) return 2;
+    return 3;
+}
+
+/// Bilinear taps from a weight grid onto each texel of the footprint: grid entries base,
+/// base + 1, base + grid_width and base + grid_width + 1, with factors summing to 16.
+struct ASTCInfill {
+    std::once_flag built;
+    u8 base[ASTC_MAX_TEXELS];
+    u8 factors[ASTC_MAX_TEXELS][4];
+};
+
+struct ASTCPartitioning {
+    std::once_flag built;
+    u8 partition[ASTC_MAX_TEXELS];
+};
+
+/// Tables for one footprint. Each entry is filled in the first time a block needs it, so a
+/// texture only pays for the grids and partition patterns it actually uses.
+struct ASTCFootprint {
+    Extent2D block;
+    ASTCInfill infills[11][11];                                    ///< By grid width and height, from 2
+    ASTCPartitioning partitionings[3][ASTC_PARTITION_SEEDS];       ///< By partition count, from 2
+
+    const ASTCInfill& Infill(u32 grid_width, u32 grid_height) {
+        ASTCInfill& infill = infills[grid_width - 2][grid_height - 2];
+        std::call_once(infill.built, [&] {
+            const u32 ds = (1024 + block.width / 2) / (block.width - 1);
+            const u32 dt = (1024 + block.height / 2) / (block.height - 1);
+            for (u32 t = 0; t < block.height; ++t) {
+                for (u32 s = 0; s < block.width; ++s) {
+                    const u32 gs = (ds * s * (grid_width - 1) + 32) >> 6;
+                    const u32 gt = (dt * t * (grid_height - 1) + 32) >> 6;
+                    const u32 fs = gs & 0xF;
+                    const u32 ft = gt & 0xF;
+                    const u32 w11 = (fs * ft + 8) >> 4;
+                    const u32 i = t * block.width + s;
+                    infill.base[i] = static_cast<u8>((gs >> 4) + (gt >> 4) * grid_width);
+                    infill.factors[i][0] = static_cast<u8>(16 - fs - ft + w11);
+                    infill.factors[i][1] = static_cast<u8>(fs - w11);
+                    infill.factors[i][2] = static_cast<u8>(ft - w11);
+                    infill.factors[i][3] = static_cast<u8>(w11);
+                }
+            }
+        });
+        return infill;
+    }
+
+    const u8* Partitions(u32 count, u32 seed) {
+        ASTCPartitioning& partitioning = partitionings[count - 2][seed];
+        std::call_once(partitioning.built, [&] {
+            const bool small_block = block.width * block.height < 31;
+            for (u32 y = 0; y < block.height; ++y) {
+                for (u32 x = 0; x < block.width; ++x) {
+                    partitioning.partition[y * block.width + x] =
+                        static_cast<u8>(SelectPartition(seed, x, y, count, small_block));
+                }
+            }
+        });
+        return partitioning.partition;
+    }
+};
+
+static ASTCFootprint& GetASTCFootprint(Extent2D block) {
+    static std::once_flag created[9][9];
+    static std::unique_ptr<ASTCFootprint> footprints[9][9];
+    const u32 i = block.width - 4;
+    const u32 j = block.height - 4;
+    std::call_once(created[i][j], [&] {
+        footprints[i][j] = std::make_unique<ASTCFootprint>();
+        footprints[i][j]->block = block;
+    });
+    return *footprints[i][j];
+}
+
+struct ASTCEndpoints {
+    u8 lo[4];
+    u8 hi[4];
+};
+
+/// Moves the top bit of the offset a onto the base b and sign-extends what is left of a.
+static void BitTransferSigned(s32& a, s32& b) {
+    b = (b >> 1) | (a & 0x80);
+    a = (a >> 1) & 0x3F;
+    if (a & 0x20) a -= 0x40;
+}
+
+static u8 ClampByte(s32 value) {
+    return static_cast<u8>(std::clamp(value, 0, 255));
+}
+
+static void SetEndpoint(u8* endpoint, s32 r, s32 g, s32 b, s32 a) {
+    endpoint[0] = ClampByte(r);
+    endpoint[1] = ClampByte(g);
+    endpoint[2] = ClampByte(b);
+    endpoint[3] = ClampByte(a);
+}
+
+/// Pulls red and green halfway towards blue, undoing the encoder's blue contraction.
+static void SetBlueContracted(u8* endpoint, s32 r, s32 g, s32 b, s32 a) {
+    SetEndpoint(endpoint, (r + b) >> 1, (g + b) >> 1, b, a);
+}
+
+/// Builds one partition's endpoints from its colour values. Returns false for the HDR modes.
+static bool DecodeEndpoints(u32 cem, const u8* values, ASTCEndpoints& out) {
+    s32 v[8];
+    for (u32 i = 0; i < (cem / 4 + 1) * 2; ++i) {
+        v[i] = values[i];
+    }
+    switch (cem) {
+        case 0: // luminance
+            SetEndpoint(out.lo, v[0], v[0], v[0], 0xFF);
+            SetEndpoint(out.hi, v[1], v[1], v[1], 0xFF);
+            return true;
+        case 1: { // luminance, base and offset
+            const s32 l0 = (v[0] >> 2) | (v[1] & 0xC0);
+            const s32 l1 = l0 + (v[1] & 0x3F);
+            SetEndpoint(out.lo, l0, l0, l0, 0xFF);
+            SetEndpoint(out.hi, l1, l1, l1, 0xFF);
+            return true;
+        }
+        case 4: // luminance and alpha
+            SetEndpoint(out.lo, v[0], v[0], v[0], v[2]);
+            SetEndpoint(out.hi, v[1], v[1], v[1], v[3]);
+            return true;
+        case 5: // luminance and alpha, base and offset
+            BitTransferSigned(v[1], v[0]);
+            BitTransferSigned(v[3], v[2]);
+            SetEndpoint(out.lo, v[0], v[0], v[0], v[2]);
+            SetEndpoint(out.hi, v[0] + v[1], v[0] + v[1], v[0] + v[1], v[2] + v[3]);
+            return true;
+        case 6: // RGB and scale
+            SetEndpoint(out.lo, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, 0xFF);
+            SetEndpoint(out.hi, v[0], v[1], v[2], 0xFF);
+            return true;
+        case 8:   // RGB
+        case 12:  // RGBA
+        {
+            const s32 a0 = cem == 12 ? v[6] : 0xFF;
+            const s32 a1 = cem == 12 ? v[7] : 0xFF;
+            if (v[1] + v[3] + v[5] >= v[0] + v[2] + v[4]) {
+                SetEndpoint(out.lo, v[0], v[2], v[4], a0);
+                SetEndpoint(out.hi, v[1], v[3], v[5], a1);
+            } else {
+                SetBlueContracted(out.lo, v[1], v[3], v[5], a1);
+                SetBlueContracted(out.hi, v[0], v[2], v[4], a0);
+            }
+            return true;
+        }
+        case 9:   // RGB, base and offset
+        case 13:  // RGBA, base and offset
+        {
+            BitTransferSigned(v[1], v[0]);
+            BitTransferSigned(v[3], v[2]);
+            BitTransferSigned(v[5], v[4]);
+            if (cem == 13) {
+                BitTransferSigned(v[7], v[6]);
+            } else {
+                v[6] = 0xFF;
+                v[7] = 0;
+            }
+            if (v[1] + v[3] + v[5] >= 0) {
+                SetEndpoint(out.lo, v[0], v[2], v[4], v[6]);
+                SetEndpoint(out.hi, v[0] + v[1], v[2] + v[3], v[4] + v[5], v[6] + v[7]);
+            } else {
+                SetBlueContracted(out.lo, v[0] + v[1], v[2] + v[3], v[4] + v[5], v[6] + v[7]);
+                SetBlueContracted(out.hi, v[0], v[2], v[4], v[6]);
+            }
+            return true;
+        }
+        case 10: // RGB and scale, plus two alphas
+            SetEndpoint(out.lo, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, v[4]);
+            SetEndpoint(out.hi, v[0], v[1], v[2], v[5]);
+            return true;
+        default: // 2, 3, 7, 11, 14 and 15 are HDR
+            return false;
+    }
+}
+
+/// Decodes one block into block.width x block.height RGBA8 pixels, rows packed together.
+/// Returns false for blocks that should show the error colour.
+template <bool SRGB>
+static bool DecodeASTCBlock(const u8* block, ASTCFootprint& footprint, u8* pixels) {
+    const Extent2D size = footprint.block;
+    const u32 texels = size.width * size.height;
+    ASTCBits bits;
+    std::memcpy(bits.words, block, 16);
+
+    const u32 mode_bits = bits.Read(0, 11);
+    if ((mode_bits & 0x1FF) == 0x1FC) {
+        // Void extent: one colour for the whole block. The extent coordinates are only a hint.
+        if ((mode_bits & 0x200) || bits.Read(10, 2) != 3) return false;
+        u8 color[4];
+        for (u32 c = 0; c < 4; ++c) {
+            color[c] = static_cast<u8>(bits.Read(64 + c * 16, 16) >> 8);
+        }
+        for (u32 i = 0; i < texels; ++i) {
+            std::memcpy(pixels + i * 4, color, 4);
+        }
+        return true;
+    }
+
+    const ASTCBlockMode& mode = ASTC_BLOCK_MODES[mode_bits];
+    if (!mode.valid || mode.grid_width > size.width || mode.grid_height > size.height) return false;
+    const u32 partitions = bits.Read(11, 2) + 1;
+    if (mode.dual_plane && partitions == ASTC_MAX_PARTITIONS) return false;
+
+    // Colour endpoint modes. With several partitions that don't share one, the selector bits that
+    // don't fit after the partition seed sit just below the weights.
+    u32 cems[ASTC_MAX_PARTITIONS];
+    u32 color_start;
+    u32 below_weights = ASTC_BLOCK_BITS - mode.weight_bits;
+    if (partitions == 1) {
+        cems[0] = bits.Read(13, 4);
+        color_start = 17;
+    } else {
+        color_start = 29;
+        const u32 selector = bits.Read(23, 6);
+        if ((selector & 3) == 0) {
+            for (u32 p = 0; p < partitions; ++p) {
+                cems[p] = selector >> 2;
+            }
+        } else {
+            const u32 extra_bits = partitions * 3 - 4;
+            below_weights -= extra_bits;
+            const u32 encoded = (selector | (bits.Read(below_weights, extra_bits) << 6)) >> 2;
+            const u32 base_class = (selector & 3) - 1;
+            for (u32 p = 0; p < partitions; ++p) {
+                const u32 cem_class = base_class + ((encoded >> p) & 1);
+                cems[p] = (cem_class << 2) | ((encoded >> (partitions + p * 2)) & 3);
+            }
+        }
+    }
+    u32 dual_channel = 4;
+    if (mode.dual_plane) {
+        below_weights -= 2;
+        dual_channel = bits.Read(below_weights, 2);
+    }
+
+    u32 num_values = 0;
+    for (u32 p = 0; p < partitions; ++p) {
+        num_values += (cems[p] / 4 + 1) * 2;
+    }
+    if (num_values > ASTC_MAX_COLOR_VALUES || below_weights < color_start) return false;
+    const u32 color_bits = below_weights - color_start;
+    u32 color_level = ISE_LEVELS - 1;
+    while (color_level > 0 && ISEBits(color_level, num_values) > color_bits) {
+        --color_level;
+    }
+    if (color_level < ISE_LEVEL_6) return false;
+
+    u8 values[ASTC_MAX_COLOR_VALUES];
+    DecodeISE(bits.Slice(color_start, ISEBits(color_level, num_values)), color_level, num_values, values);
+    for (u32 i = 0; i < num_values; ++i) {
+        values[i] = COLOR_UNQUANTIZE[color_level][values[i]];
+    }
+    ASTCEndpoints endpoints[ASTC_MAX_PARTITIONS];
+    const u8* next_values = values;
+    for (u32 p = 0; p < partitions; ++p) {
+        if (!DecodeEndpoints(cems[p], next_values, endpoints[p])) return false;
+        next_values += (cems[p] / 4 + 1) * 2;
+    }
+
+    // Weights, split into planes and padded so the infill taps past the last grid entry read 0.
+    const u32 planes = mode.dual_plane ? 2 : 1;
+    const u32 grid_size = mode.grid_width * mode.grid_height;
+    u8 encoded_weights[ASTC_MAX_WEIGHTS];
+    DecodeISE(bits.Reversed().Slice(0, mode.weight_bits), mode.weight_level, grid_size * planes,
+              encoded_weights);
+    u8 grid[2][ASTC_MAX_WEIGHTS + 16]{};
+    for (u32 i = 0; i < grid_size; ++i) {
+        for (u32 plane = 0; plane < planes; ++plane) {
+            grid[plane][i] = WEIGHT_UNQUANTIZE[mode.weight_level][encoded_weights[i * planes + plane]];
+        }
+    }
+
+    u8 texel_weights[2][ASTC_MAX_TEXELS];
+    if (grid_size == texels) {
+        for (u32 plane = 0; plane < planes; ++plane) {
+            std::memcpy(texel_weights[plane], grid[plane], texels);
+        }
+    } else {
+        const ASTCInfill& infill = footprint.Infill(mode.grid_width, mode.grid_height);
+        const u32 row = mode.grid_width;
+        for (u32 plane = 0; plane < planes; ++plane) {
+            const u8* g = grid[plane];
+            for (u32 i = 0; i < texels; ++i) {
+                const u32 base = infill.base[i];
+                const u8* f = infill.factors[i];
+                texel_weights[plane][i] = static_cast<u8>(
+                    (g[base] * f[0] + g[base + 1] * f[1] + g[base + row] * f[2] + g[base + row + 1] * f[3] + 8) >> 4);
+            }
+        }
+    }
+
+    // Gather each texel's endpoints and per-channel weights, then blend everything in one flat
+    // loop. The loop runs in fixed chunks of 16 so it vectorises without a scalar tail; the padding
+    // past the last texel is zeroed and never copied out.
+    u16 endpoint_values[ASTC_MAX_PARTITIONS][2][4];
+    for (u32 p = 0; p < partitions; ++p) {
+        for (u32 c = 0; c < 4; ++c) {
+            endpoint_values[p][0][c] = endpoints[p].lo[c];
+            endpoint_values[p][1][c] = endpoints[p].hi[c];
+        }
+    }
+    static constexpr u8 ONE_PARTITION[ASTC_MAX_TEXELS]{};
+    const u8* partition = partitions > 1 ? footprint.Partitions(partitions, bits.Read(13, 10)) : ONE_PARTITION;
+
+    constexpr u32 CHUNK = 16;
+    const u32 values_used = texels * 4;
+    const u32 values_padded = (values_used + CHUNK - 1) / CHUNK * CHUNK;
+    u16 lo[ASTC_MAX_TEXELS * 4];
+    u16 hi[ASTC_MAX_TEXELS * 4];
+    u16 weight[ASTC_MAX_TEXELS * 4];
+    for (u32 i = 0; i < texels; ++i) {
+        std::memcpy(lo + i * 4, endpoint_values[partition[i]][0], sizeof(endpoint_values[0][0]));
+        std::memcpy(hi + i * 4, endpoint_values[partition[i]][1], sizeof(endpoint_values[0][1]));
+    }
+    // A texel's weight goes to all four channels at once, with the second plane's swapped into
+    // its channel in dual-plane blocks.
+    constexpr u64 BROADCAST = 0x0001000100010001;
+    const u32 plane2_shift = (dual_channel & 3) * 16;
+    const u64 plane2_mask = mode.dual_plane ? u64{0xFFFF} << plane2_shift : 0;
+    for (u32 i = 0; i < texels; ++i) {
+        const u64 weights = (texel_weights[0][i] * BROADCAST & ~plane2_mask) |
+                            (u64{texel_weights[planes - 1][i]} << plane2_shift & plane2_mask);
+        std::memcpy(weight + i * 4, &weights, sizeof(weights));
+    }
+    for (u32 i = values_used; i < values_padded; ++i) {
+        lo[i] = hi[i] = weight[i] = 0;
+    }
+    // With the endpoints widened to 16 bits as e * 257 (or e * 256 + 128 for sRGB), the top byte
+    // of the interpolated value works out from the 8-bit blend m alone, so the whole thing stays
+    // in 16-bit lanes.
+    for (u32 i = 0; i < values_padded; i += CHUNK) {
+        for (u32 j = 0; j < CHUNK; ++j) {
+            const u16 w = weight[i + j];
+            const u16 m = static_cast<u16>(lo[i + j] * (64 - w) + hi[i + j] * w);
+            pixels[i + j] = static_cast<u8>(SRGB ? (m + 32) >> 6 : (m + ((m + 32) >> 8)) >> 6);
+        }
+    }
+    return true;
+}
+
+template <bool SRGB>
+static void DecodeASTCBlocks(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block) {
+    ASTCFootprint& footprint = GetASTCFootprint(block);
+    const u32 row_bytes = block.width * 4;
+    const u32 texels = block.width * block.height;
+    for (u32 i = 0; i < count; ++i) {
+        u8 pixels[ASTC_MAX_TEXELS * 4];
+        if (!DecodeASTCBlock<SRGB>(blocks + i * 16, footprint, pixels)) {
+            for (u32 j = 0; j < texels; ++j) {
+                std::memcpy(pixels + j * 4, ASTC_ERROR_COLOR, 4);
+            }
+        }
+        for (u32 y = 0; y < block.height; ++y) {
+            std::memcpy(out + y * out_pitch + i * row_bytes, pixels + y * row_bytes, row_bytes);
+        }
+    }
+}
+
+void DecodeASTCRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block) {
+    DecodeASTCBlocks<false>(blocks, count, out, out_pitch, block);
+}
+
+void DecodeASTCSrgbRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block) {
+    DecodeASTCBlocks<true>(blocks, count, out, out_pitch, block);
+}
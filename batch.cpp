@@ -0,0 +1,25 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "parallel.h"
+#include "ykcmp.h"
+
+extern "C" YKCMP_API
+u32 decompress_batch(const YKCMPBatchItem* items, u32 count, u32 num_threads, s32* status) {
+    // Hand out the biggest buffers first so a large file picked up last doesn't leave the other
+    // threads idle at the end.
+    std::vector<u32> order(count);
+    std::iota(order.begin(), order.end(), 0U);
+    std::stable_sort(order.begin(), order.end(), [items](u32 a, u32 b) {
+        return items[a].out_size > items[b].out_size;
+    });
+
+    std::atomic<u32> failed{0};
+    ParallelFor(count, num_threads, [&](u32 i) {
+        const YKCMPBatchItem& item = items[order[i]];
+        const s32 result = decompress_safe(item.in, item.in_size, item.out, item.out_size);
+        if (status) status[order[i]] = result;
+        if (result != YKCMP_OK) failed.fetch_add(1, std::memory_order_relaxed);
+    });
+    return failed.load();
+}
@@ -0,0 +1,457 @@
+// Block decoders for BC1-BC7. Every block is 4x4 pixels; BC6H decodes to RGBA16F and the rest to
+// RGBA8. sRGB variants decode to the same bytes, still sRGB encoded. BC4/BC5 fill the channels
+// they carry and leave the others at 0 (alpha at 255); SNORM values map -1..1 onto 0..255.
+
+#include <bit>
+#include "bcn.h"
+#include "decode.h"
+
+/// Reads a 128-bit block as a little-endian bit stream. A zero third word lets reads that
+/// straddle the two halves, or end exactly at bit 128, go without branches.
+class BlockBitReader {
+public:
+    explicit BlockBitReader(const u8* block) {
+        std::memcpy(words, block, 16);
+    }
+
+    /// Up to 63 bits, enough for a whole set of indices in one go.
+    u64 ReadWide(u32 count) {
+        const u32 word = pos >> 6;
+        const u32 shift = pos & 63;
+        const u64 value = (words[word] >> shift) | ((words[word + 1] << 1) << (63 - shift));
+        pos += count;
+        return value & ((u64{1} << count) - 1);
+    }
+
+    u32 Read(u32 count) {
+        return static_cast<u32>(ReadWide(count));
+    }
+
+    void Skip(u32 count) {
+        pos += count;
+    }
+
+private:
+    u64 words[3]{};
+    u32 pos = 0;
+};
+
+/// Writes decoded 4x4 pixel blocks out to a row.
+template <u32 BLOCK_BYTES, u32 OUT_BPP, typename DecodeBlockFn>
+static void DecodeRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, DecodeBlockFn&& decode_block) {
+    for (u32 i = 0; i < count; ++i) {
+        u8 pixels[BC_BLOCK_PIXELS * OUT_BPP];
+        decode_block(blocks + i * BLOCK_BYTES, pixels);
+        for (u32 y = 0; y < 4; ++y) {
+            std::memcpy(out + y * out_pitch + i * 4 * OUT_BPP, pixels + y * 4 * OUT_BPP, 4 * OUT_BPP);
+        }
+    }
+}
+
+/// Colour half of BC1-BC3.
+static void DecodeBC1Colors(const u8* block, u8* pixels, bool allow_transparent) {
+    const u32 c0 = block[0] | (block[1] << 8);
+    const u32 c1 = block[2] | (block[3] << 8);
+    u32 indices;
+    std::memcpy(&indices, block + 4, sizeof(indices));
+
+    u8 palette[4][4];
+    BC1Palette(c0, c1, allow_transparent, palette);
+
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        std::memcpy(pixels + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+/// BC4 block (also BC3 alpha and each BC5 channel) into one byte per pixel, 4 bytes apart.
+template <bool SIGNED>
+static void DecodeBC4Channel(const u8* block, u8* out) {
+    s32 a0 = SIGNED ? static_cast<s8>(block[0]) : block[0];
+    s32 a1 = SIGNED ? static_cast<s8>(block[1]) : block[1];
+    if constexpr (SIGNED) {
+        a0 = std::max(a0, -127);
+        a1 = std::max(a1, -127);
+    }
+
+    s32 palette[8];
+    BC4Palette(a0, a1, SIGNED, palette);
+    if constexpr (SIGNED) {
+        for (s32& value : palette) {
+            value = ((value + 127) * 255 + 127) / 254;
+        }
+    }
+
+    u64 indices = 0;
+    std::memcpy(&indices, block + 2, 6);
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        out[i * 4] = static_cast<u8>(palette[(indices >> (i * 3)) & 7]);
+    }
+}
+
+void DecodeBC1Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<8, 4>(blocks, count, out, out_pitch, [](const u8* block, u8* pixels) {
+        DecodeBC1Colors(block, pixels, true);
+    });
+}
+
+void DecodeBC2Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<16, 4>(blocks, count, out, out_pitch, [](const u8* block, u8* pixels) {
+        DecodeBC1Colors(block + 8, pixels, false);
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            pixels[i * 4 + 3] = static_cast<u8>(((block[i / 2] >> ((i % 2) * 4)) & 0xF) * 17);
+        }
+    });
+}
+
+void DecodeBC3Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<16, 4>(blocks, count, out, out_pitch, [](const u8* block, u8* pixels) {
+        DecodeBC1Colors(block + 8, pixels, false);
+        DecodeBC4Channel<false>(block, pixels + 3);
+    });
+}
+
+template <bool SIGNED>
+static void DecodeBC4Block(const u8* block, u8* pixels) {
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        pixels[i * 4 + 1] = 0;
+        pixels[i * 4 + 2] = 0;
+        pixels[i * 4 + 3] = 255;
+    }
+    DecodeBC4Channel<SIGNED>(block, pixels);
+}
+
+template <bool SIGNED>
+static void DecodeBC5Block(const u8* block, u8* pixels) {
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        pixels[i * 4 + 2] = 0;
+        pixels[i * 4 + 3] = 255;
+    }
+    DecodeBC4Channel<SIGNED>(block, pixels);
+    DecodeBC4Channel<SIGNED>(block + 8, pixels + 1);
+}
+
+void DecodeBC4URow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<8, 4>(blocks, count, out, out_pitch, DecodeBC4Block<false>);
+}
+
+void DecodeBC4SRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<8, 4>(blocks, count, out, out_pitch, DecodeBC4Block<true>);
+}
+
+void DecodeBC5URow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<16, 4>(blocks, count, out, out_pitch, DecodeBC5Block<false>);
+}
+
+void DecodeBC5SRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<16, 4>(blocks, count, out, out_pitch, DecodeBC5Block<true>);
+}
+
+
+/// Reads a block's 16 indices of index_bits each, the pixels set in anchors being one bit short.
+static void UnpackIndices(BlockBitReader& bits, u32 index_bits, u32 anchors, u32* indices) {
+    const u32 total = BC_BLOCK_PIXELS * index_bits - std::popcount(anchors);
+    const u64 packed = bits.ReadWide(total);
+    const u32 mask = (1U << index_bits) - 1;
+    u32 pos = 0;
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        const u32 anchor = (anchors >> i) & 1;
+        indices[i] = static_cast<u32>(packed >> pos) & (mask >> anchor);
+        pos += index_bits - anchor;
+    }
+}
+
+
+static void DecodeBC7Block(const u8* block, u8* pixels) {
+    if (block[0] == 0) {
+        // Reserved mode: transparent black.
+        std::memset(pixels, 0, BC_BLOCK_PIXELS * 4);
+        return;
+    }
+    const u32 mode_index = std::countr_zero(block[0]);
+    const BC7Mode& mode = BC7_MODES[mode_index];
+
+    BlockBitReader bits(block);
+    bits.Skip(mode_index + 1);
+    const u32 partition = bits.Read(mode.partition_bits);
+    const u32 rotation = bits.Read(mode.rotation_bits);
+    const u32 index_selection = bits.Read(mode.index_selection_bits);
+
+    // endpoints[subset][endpoint][channel]
+    u32 endpoints[3][2][4]{};
+    for (u32 channel = 0; channel < 3; ++channel) {
+        for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+            endpoints[subset][0][channel] = bits.Read(mode.color_bits);
+            endpoints[subset][1][channel] = bits.Read(mode.color_bits);
+        }
+    }
+    for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+        endpoints[subset][0][3] = bits.Read(mode.alpha_bits);
+        endpoints[subset][1][3] = bits.Read(mode.alpha_bits);
+    }
+
+    const u32 pbits = mode.endpoint_pbits | mode.shared_pbits;
+    if (pbits) {
+        for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+            const u32 p0 = bits.Read(1);
+            const u32 p1 = mode.endpoint_pbits ? bits.Read(1) : p0;
+            for (u32 channel = 0; channel < 4; ++channel) {
+                endpoints[subset][0][channel] = (endpoints[subset][0][channel] << 1) | p0;
+                endpoints[subset][1][channel] = (endpoints[subset][1][channel] << 1) | p1;
+            }
+        }
+    }
+
+    // Widen to 8 bits by replicating the top bits; modes without alpha are opaque.
+    const u32 color_bits = mode.color_bits + pbits;
+    const u32 alpha_bits = mode.alpha_bits ? mode.alpha_bits + pbits : 0;
+    for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+        for (auto& endpoint : endpoints[subset]) {
+            for (u32 channel = 0; channel < 3; ++channel) {
+                endpoint[channel] = (endpoint[channel] << (8 - color_bits)) |
+                    (endpoint[channel] >> (2 * color_bits - 8));
+            }
+            endpoint[3] = alpha_bits ? (endpoint[3] << (8 - alpha_bits)) | (endpoint[3] >> (2 * alpha_bits - 8))
+                                     : 255;
+        }
+    }
+
+    u32 anchors = 1;
+    const u8* subsets = BC7_PARTITIONS_2[0]; // Ignored for one subset
+    if (mode.num_subsets == 2) {
+        anchors |= 1U << BC7_ANCHORS_2[partition];
+        subsets = BC7_PARTITIONS_2[partition];
+    } else if (mode.num_subsets == 3) {
+        anchors |= (1U << BC7_ANCHORS_3_SECOND[partition]) | (1U << BC7_ANCHORS_3_THIRD[partition]);
+        subsets = BC7_PARTITIONS_3[partition];
+    }
+
+    u32 indices[BC_BLOCK_PIXELS];
+    u32 indices2[BC_BLOCK_PIXELS]{};
+    UnpackIndices(bits, mode.index_bits, anchors, indices);
+    if (mode.index2_bits) {
+        UnpackIndices(bits, mode.index2_bits, 1, indices2);
+    }
+
+    // With two index sets, the second one drives alpha unless the selection bit swaps them.
+    const bool swap = index_selection != 0;
+    const u32* color_indices = swap ? indices2 : indices;
+    const u32* alpha_indices = mode.index2_bits && !swap ? indices2 : indices;
+    const u8* color_weights = Weights(swap ? mode.index2_bits : mode.index_bits);
+    const u8* alpha_weights = Weights(mode.index2_bits && !swap ? mode.index2_bits : mode.index_bits);
+    // Gather each pixel's endpoints and weights first so the blend below is one flat loop over 64
+    // channels, which compilers turn into 16-bit vector multiplies.
+    u16 lo[BC_BLOCK_PIXELS * 4];
+    u16 hi[BC_BLOCK_PIXELS * 4];
+    u16 weight[BC_BLOCK_PIXELS * 4];
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        const auto& e = endpoints[mode.num_subsets == 1 ? 0 : subsets[i]];
+        const u16 color_weight = color_weights[color_indices[i]];
+        for (u32 channel = 0; channel < 4; ++channel) {
+            lo[i * 4 + channel] = static_cast<u16>(e[0][channel]);
+            hi[i * 4 + channel] = static_cast<u16>(e[1][channel]);
+            weight[i * 4 + channel] = color_weight;
+        }
+        weight[i * 4 + 3] = alpha_weights[alpha_indices[i]];
+    }
+    for (u32 i = 0; i < BC_BLOCK_PIXELS * 4; ++i) {
+        pixels[i] = static_cast<u8>(((64 - weight[i]) * lo[i] + weight[i] * hi[i] + 32) >> 6);
+    }
+    if (rotation != 0) {
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            std::swap(pixels[i * 4 + 3], pixels[i * 4 + rotation - 1]);
+        }
+    }
+}
+
+void DecodeBC7Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<16, 4>(blocks, count, out, out_pitch, DecodeBC7Block);
+}
+
+/// One run of endpoint bits in a BC6H block: bits first..last (in stream order, either way round)
+/// of channel `channel` of endpoint `endpoint`. Endpoints 0/1 are region 0, 2/3 region 1.
+struct BC6HField {
+    u8 endpoint;
+    u8 channel;
+    u8 first;
+    u8 last;
+};
+
+struct BC6HMode {
+    u8 mode_bits;
+    u8 num_regions;
+    bool transformed;
+    u8 endpoint_bits;
+    u8 delta_bits[3];
+    u8 num_fields;
+    BC6HField fields[24];
+};
+
+// Field layouts from the D3D11 BC6H specification, in the order the bits are stored.
+constexpr BC6HMode BC6H_MODES[14] = {
+    {2, 2, true, 10, {5, 5, 5}, 19, {{2, 1, 4, 4}, {2, 2, 4, 4}, {3, 2, 4, 4}, {0, 0, 0, 9}, {0, 1, 0, 9},
+        {0, 2, 0, 9}, {1, 0, 0, 4}, {3, 1, 4, 4}, {2, 1, 0, 3}, {1, 1, 0, 4}, {3, 2, 0, 0}, {3, 1, 0, 3},
+        {1, 2, 0, 4}, {3, 2, 1, 1}, {2, 2, 0, 3}, {2, 0, 0, 4}, {3, 2, 2, 2}, {3, 0, 0, 4}, {3, 2, 3, 3}}},
+    {2, 2, true, 7, {6, 6, 6}, 23, {{2, 1, 5, 5}, {3, 1, 4, 4}, {3, 1, 5, 5}, {0, 0, 0, 6}, {3, 2, 0, 0},
+        {3, 2, 1, 1}, {2, 2, 4, 4}, {0, 1, 0, 6}, {2, 2, 5, 5}, {3, 2, 2, 2}, {2, 1, 4, 4}, {0, 2, 0, 6},
+        {3, 2, 3, 3}, {3, 2, 5, 5}, {3, 2, 4, 4}, {1, 0, 0, 5}, {2, 1, 0, 3}, {1, 1, 0, 5}, {3, 1, 0, 3},
+        {1, 2, 0, 5}, {2, 2, 0, 3}, {2, 0, 0, 5}, {3, 0, 0, 5}}},
+    {5, 2, true, 11, {5, 4, 4}, 18, {{0, 0, 0, 9}, {0, 1, 0, 9}, {0, 2, 0, 9}, {1, 0, 0, 4}, {0, 0, 10, 10},
+        {2, 1, 0, 3}, {1, 1, 0, 3}, {0, 1, 10, 10}, {3, 2, 0, 0}, {3, 1, 0, 3}, {1, 2, 0, 3}, {0, 2, 10, 10},
+        {3, 2, 1, 1}, {2, 2, 0, 3}, {2, 0, 0, 4}, {3, 2, 2, 2}, {3, 0, 0, 4}, {3, 2, 3, 3}}},
+    {5, 2, true, 11, {4, 5, 4}, 20, {{0, 0, 0, 9}, {0, 1, 0, 9}, {0, 2, 0, 9}, {1, 0, 0, 3}, {0, 0, 10, 10},
+        {3, 1, 4, 4}, {2, 1, 0, 3}, {1, 1, 0, 4}, {0, 1, 10, 10}, {3, 1, 0, 3}, {1, 2, 0, 3}, {0, 2, 10, 10},
+        {3, 2, 1, 1}, {2, 2, 0, 3}, {2, 0, 0, 3}, {3, 2, 0, 0}, {3, 2, 2, 2}, {3, 0, 0, 3}, {2, 1, 4, 4},
+        {3, 2, 3, 3}}},
+    {5, 2, true, 11, {4, 4, 5}, 20, {{0, 0, 0, 9}, {0, 1, 0, 9}, {0, 2, 0, 9}, {1, 0, 0, 3}, {0, 0, 10, 10},
+        {2, 2, 4, 4}, {2, 1, 0, 3}, {1, 1, 0, 3}, {0, 1, 10, 10}, {3, 2, 0, 0}, {3, 1, 0, 3}, {1, 2, 0, 4},
+        {0, 2, 10, 10}, {2, 2, 0, 3}, {2, 0, 0, 3}, {3, 2, 1, 1}, {3, 2, 2, 2}, {3, 0, 0, 3}, {3, 2, 4, 4},
+        {3, 2, 3, 3}}},
+    {5, 2, true, 9, {5, 5, 5}, 19, {{0, 0, 0, 8}, {2, 2, 4, 4}, {0, 1, 0, 8}, {2, 1, 4, 4}, {0, 2, 0, 8},
+        {3, 2, 4, 4}, {1, 0, 0, 4}, {3, 1, 4, 4}, {2, 1, 0, 3}, {1, 1, 0, 4}, {3, 2, 0, 0}, {3, 1, 0, 3},
+        {1, 2, 0, 4}, {3, 2, 1, 1}, {2, 2, 0, 3}, {2, 0, 0, 4}, {3, 2, 2, 2}, {3, 0, 0, 4}, {3, 2, 3, 3}}},
+    {5, 2, true, 8, {6, 5, 5}, 19, {{0, 0, 0, 7}, {3, 1, 4, 4}, {2, 2, 4, 4}, {0, 1, 0, 7}, {3, 2, 2, 2},
+        {2, 1, 4, 4}, {0, 2, 0, 7}, {3, 2, 3, 3}, {3, 2, 4, 4}, {1, 0, 0, 5}, {2, 1, 0, 3}, {1, 1, 0, 4},
+        {3, 2, 0, 0}, {3, 1, 0, 3}, {1, 2, 0, 4}, {3, 2, 1, 1}, {2, 2, 0, 3}, {2, 0, 0, 5}, {3, 0, 0, 5}}},
+    {5, 2, true, 8, {5, 6, 5}, 21, {{0, 0, 0, 7}, {3, 2, 0, 0}, {2, 2, 4, 4}, {0, 1, 0, 7}, {2, 1, 5, 5},
+        {2, 1, 4, 4}, {0, 2, 0, 7}, {3, 1, 5, 5}, {3, 2, 4, 4}, {1, 0, 0, 4}, {3, 1, 4, 4}, {2, 1, 0, 3},
+        {1, 1, 0, 5}, {3, 1, 0, 3}, {1, 2, 0, 4}, {3, 2, 1, 1}, {2, 2, 0, 3}, {2, 0, 0, 4}, {3, 2, 2, 2},
+        {3, 0, 0, 4}, {3, 2, 3, 3}}},
+    {5, 2, true, 8, {5, 5, 6}, 21, {{0, 0, 0, 7}, {3, 2, 1, 1}, {2, 2, 4, 4}, {0, 1, 0, 7}, {2, 2, 5, 5},
+        {2, 1, 4, 4}, {0, 2, 0, 7}, {3, 2, 5, 5}, {3, 2, 4, 4}, {1, 0, 0, 4}, {3, 1, 4, 4}, {2, 1, 0, 3},
+        {1, 1, 0, 4}, {3, 2, 0, 0}, {3, 1, 0, 3}, {1, 2, 0, 5}, {2, 2, 0, 3}, {2, 0, 0, 4}, {3, 2, 2, 2},
+        {3, 0, 0, 4}, {3, 2, 3, 3}}},
+    {5, 2, false, 6, {6, 6, 6}, 23, {{0, 0, 0, 5}, {3, 1, 4, 4}, {3, 2, 0, 0}, {3, 2, 1, 1}, {2, 2, 4, 4},
+        {0, 1, 0, 5}, {2, 1, 5, 5}, {2, 2, 5, 5}, {3, 2, 2, 2}, {2, 1, 4, 4}, {0, 2, 0, 5}, {3, 1, 5, 5},
+        {3, 2, 3, 3}, {3, 2, 5, 5}, {3, 2, 4, 4}, {1, 0, 0, 5}, {2, 1, 0, 3}, {1, 1, 0, 5}, {3, 1, 0, 3},
+        {1, 2, 0, 5}, {2, 2, 0, 3}, {2, 0, 0, 5}, {3, 0, 0, 5}}},
+    {5, 1, false, 10, {10, 10, 10}, 6, {{0, 0, 0, 9}, {0, 1, 0, 9}, {0, 2, 0, 9}, {1, 0, 0, 9}, {1, 1, 0, 9},
+        {1, 2, 0, 9}}},
+    {5, 1, true, 11, {9, 9, 9}, 9, {{0, 0, 0, 9}, {0, 1, 0, 9}, {0, 2, 0, 9}, {1, 0, 0, 8}, {0, 0, 10, 10},
+        {1, 1, 0, 8}, {0, 1, 10, 10}, {1, 2, 0, 8}, {0, 2, 10, 10}}},
+    {5, 1, true, 12, {8, 8, 8}, 9, {{0, 0, 0, 9}, {0, 1, 0, 9}, {0, 2, 0, 9}, {1, 0, 0, 7}, {0, 0, 11, 10},
+        {1, 1, 0, 7}, {0, 1, 11, 10}, {1, 2, 0, 7}, {0, 2, 11, 10}}},
+    {5, 1, true, 16, {4, 4, 4}, 9, {{0, 0, 0, 9}, {0, 1, 0, 9}, {0, 2, 0, 9}, {1, 0, 0, 3}, {0, 0, 15, 10},
+        {1, 1, 0, 3}, {0, 1, 15, 10}, {1, 2, 0, 3}, {0, 2, 15, 10}}},
+};
+
+/// BC6H_MODES index for the low five bits of a block, or -1 for the reserved encodings.
+static s32 BC6HModeIndex(u32 low_bits) {
+    switch (low_bits & 3) {
+        case 0:
+            return 0;
+        case 1:
+            return 1;
+    }
+    constexpr s8 MODES[32] = {
+        -1, -1, 2, 10, -1, -1, 3, 11, -1, -1, 4, 12, -1, -1, 5, 13,
+        -1, -1, 6, -1, -1, -1, 7, -1, -1, -1, 8, -1, -1, -1, 9, -1,
+    };
+    return MODES[low_bits & 0x1F];
+}
+
+static s32 SignExtend(u32 value, u32 bits) {
+    const u32 shift = 32 - bits;
+    return static_cast<s32>(value << shift) >> shift;
+}
+
+template <bool SIGNED>
+static s32 UnquantizeBC6H(s32 value, u32 bits) {
+    if constexpr (SIGNED) {
+        if (bits >= 16) return value;
+        const bool negative = value < 0;
+        const s32 magnitude = negative ? -value : value;
+        s32 result;
+        if (magnitude == 0) {
+            result = 0;
+        } else if (magnitude >= (1 << (bits - 1)) - 1) {
+            result = 0x7FFF;
+        } else {
+            result = ((magnitude << 15) + 0x4000) >> (bits - 1);
+        }
+        return negative ? -result : result;
+    } else {
+        if (bits >= 15) return value;
+        if (value == 0) return 0;
+        if (value == (1 << bits) - 1) return 0xFFFF;
+        return ((value << 16) + 0x8000) >> bits;
+    }
+}
+
+/// Scales an interpolated value to the half-float bit pattern it stands for.
+template <bool SIGNED>
+static u16 FinishBC6H(s32 value) {
+    if constexpr (SIGNED) {
+        return value < 0 ? static_cast<u16>(0x8000 | ((-value * 31) >> 5)) : static_cast<u16>((value * 31) >> 5);
+    } else {
+        return static_cast<u16>((value * 31) >> 6);
+    }
+}
+
+template <bool SIGNED>
+static void DecodeBC6HBlock(const u8* block, u8* pixels) {
+    const s32 mode_index = BC6HModeIndex(block[0]);
+    if (mode_index < 0) {
+        std::memset(pixels, 0, BC_BLOCK_PIXELS * 8);
+        return;
+    }
+    const BC6HMode& mode = BC6H_MODES[mode_index];
+
+    BlockBitReader bits(block);
+    bits.Skip(mode.mode_bits);
+    u32 raw[4][3]{};
+    for (u32 i = 0; i < mode.num_fields; ++i) {
+        const BC6HField& field = mode.fields[i];
+        const s32 step = field.first <= field.last ? 1 : -1;
+        for (s32 bit = field.first;; bit += step) {
+            raw[field.endpoint][field.channel] |= bits.Read(1) << bit;
+            if (bit == field.last) break;
+        }
+    }
+    const u32 partition = mode.num_regions == 2 ? bits.Read(5) : 0;
+    const u32 num_endpoints = mode.num_regions * 2;
+
+    // Endpoints other than the first are deltas from it in the transformed modes.
+    s32 endpoints[4][3];
+    for (u32 channel = 0; channel < 3; ++channel) {
+        const u32 bits_e0 = mode.endpoint_bits;
+        const u32 mask = (1U << bits_e0) - 1;
+        endpoints[0][channel] = SIGNED ? SignExtend(raw[0][channel], bits_e0) : static_cast<s32>(raw[0][channel]);
+        for (u32 e = 1; e < num_endpoints; ++e) {
+            if (mode.transformed) {
+                const s32 delta = SignExtend(raw[e][channel], mode.delta_bits[channel]);
+                const u32 value = (raw[0][channel] + delta) & mask;
+                endpoints[e][channel] = SIGNED ? SignExtend(value, bits_e0) : static_cast<s32>(value);
+            } else {
+                endpoints[e][channel] =
+                    SIGNED ? SignExtend(raw[e][channel], bits_e0) : static_cast<s32>(raw[e][channel]);
+            }
+        }
+        for (u32 e = 0; e < num_endpoints; ++e) {
+            endpoints[e][channel] = UnquantizeBC6H<SIGNED>(endpoints[e][channel], bits_e0);
+        }
+    }
+
+    const u32 index_bits = mode.num_regions == 2 ? 3 : 4;
+    const u8* weights = Weights(index_bits);
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        const u32 index = bits.Read(index_bits - IsAnchor(mode.num_regions, partition, i));
+        const u32 region = Subset(mode.num_regions, partition, i);
+        const s32* e0 = endpoints[region * 2];
+        const s32* e1 = endpoints[region * 2 + 1];
+        u16 pixel[4];
+        for (u32 channel = 0; channel < 3; ++channel) {
+            const s32 value = ((64 - weights[index]) * e0[channel] + weights[index] * e1[channel] + 32) >> 6;
+            pixel[channel] = FinishBC6H<SIGNED>(value);
+        }
+        pixel[3] = 0x3C00; // 1.0
+        std::memcpy(pixels + i * 8, pixel, sizeof(pixel));
+    }
+}
+
+void DecodeBC6HURow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<16, 8>(blocks, count, out, out_pitch, DecodeBC6HBlock<false>);
+}
+
+void DecodeBC6HSRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D) {
+    DecodeRow<16, 8>(blocks, count, out, out_pitch, DecodeBC6HBlock<true>);
+}
@@ -0,0 +1,903 @@
+// Block encoders for BC1-BC5 and BC7 from RGBA8 pixels, the inverse of bcn.cpp. sRGB formats take
+// the bytes as already sRGB encoded, the way the decoders give them back. BC1 gives pixels with
+// alpha below 128 its transparent entry; BC4/BC5 read red (and green), SNORM mapping 0..255 back
+// onto -1..1.
+//
+// Colour endpoints start at the ends of the block's (or subset's) principal axis and are refined
+// by least squares against the indices they produce, keeping whatever measures best against the
+// decoder's own palette. BC7 tries more modes as quality goes up:
+//   0: mode 6 alone, one subset with 4-bit indices, which suits most blocks.
+//   1: also two subsets (mode 1, mode 7 with alpha) on the partitions that best split the block
+//      into two lines.
+//   2: also modes 0, 2 and 3, more partitions and more refinement passes.
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include "bcn.h"
+#include "encode.h"
+
+/// Writes a 128-bit block as a little-endian bit stream.
+class BlockBitWriter {
+public:
+    /// Up to 63 bits at a time.
+    void Write(u64 value, u32 count) {
+        const u32 word = pos >> 6;
+        const u32 shift = pos & 63;
+        words[word] |= value << shift;
+        if (shift + count > 64) {
+            words[word + 1] |= value >> (64 - shift);
+        }
+        pos += count;
+    }
+
+    void Store(u8* block) const {
+        std::memcpy(block, words, 16);
+    }
+
+private:
+    u64 words[2]{};
+    u32 pos = 0;
+};
+
+/// Gathers each block's 4x4 pixels from a row and encodes them.
+template <u32 BLOCK_BYTES, typename EncodeBlockFn>
+static void EncodeRow(const u8* pixels, u32 pitch, u32 count, u8* blocks, EncodeBlockFn&& encode_block) {
+    for (u32 i = 0; i < count; ++i) {
+        u8 block_pixels[BC_BLOCK_PIXELS * 4];
+        for (u32 y = 0; y < 4; ++y) {
+            std::memcpy(block_pixels + y * 16, pixels + y * pitch + i * 16, 16);
+        }
+        encode_block(block_pixels, blocks + i * BLOCK_BYTES);
+    }
+}
+
+/// Sums over the pixels selected by a mask of 1, each channel and each product of two channels,
+/// from which their mean and covariance follow. The sums subtract, so the last subset of a
+/// partition comes from the whole block's without another pass over the pixels. Terms involving
+/// alpha come last, so colour-only stats skip them.
+struct PixelStats {
+    static constexpr u32 TERMS = 15;
+    static constexpr u8 SUM[4] = {1, 2, 3, 10};
+    static constexpr u8 PRODUCT[4][4] = {{4, 5, 6, 11}, {5, 7, 8, 12}, {6, 8, 9, 13}, {11, 12, 13, 14}};
+
+    /// Every pixel's terms, to build the stats of many masks from.
+    static void PixelTerms(const u8* pixels, float (&terms)[BC_BLOCK_PIXELS][TERMS]) {
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            terms[i][0] = 1.0f;
+            for (u32 a = 0; a < 4; ++a) {
+                terms[i][SUM[a]] = pixels[i * 4 + a];
+                for (u32 b = a; b < 4; ++b) {
+                    terms[i][PRODUCT[a][b]] = static_cast<float>(pixels[i * 4 + a] * pixels[i * 4 + b]);
+                }
+            }
+        }
+    }
+
+    PixelStats(const float (&terms)[BC_BLOCK_PIXELS][TERMS], u32 mask, u32 channels_) : channels(channels_) {
+        const u32 used = channels == 4 ? TERMS : 10;
+        for (; mask != 0; mask &= mask - 1) {
+            const float* const pixel = terms[std::countr_zero(mask)];
+            for (u32 k = 0; k < used; ++k) sums[k] += pixel[k];
+        }
+    }
+
+    PixelStats(const u8* pixels, u32 mask, u32 channels_) : channels(channels_) {
+        float terms[BC_BLOCK_PIXELS][TERMS];
+        PixelTerms(pixels, terms);
+        *this = PixelStats(terms, mask, channels);
+    }
+
+    PixelStats& operator-=(const PixelStats& other) {
+        for (u32 k = 0; k < TERMS; ++k) sums[k] -= other.sums[k];
+        return *this;
+    }
+
+    float Mean(u32 channel) const {
+        return sums[SUM[channel]] / sums[0];
+    }
+
+    /// Fills cov and returns its trace, with start set to the channel of greatest variance.
+    /// Channels past `channels` get zero covariance, so callers can always loop over all four.
+    float CovarianceMatrix(float (&cov)[4][4], u32& start) const {
+        const float inv_count = 1.0f / sums[0];
+        for (u32 a = 0; a < 4; ++a) {
+            for (u32 b = a; b < 4; ++b) {
+                cov[a][b] = cov[b][a] = a < channels && b < channels
+                    ? sums[PRODUCT[a][b]] - sums[SUM[a]] * sums[SUM[b]] * inv_count
+                    : 0.0f;
+            }
+        }
+        float trace = 0.0f;
+        start = 0;
+        for (u32 c = 0; c < 4; ++c) {
+            trace += cov[c][c];
+            if (cov[c][c] > cov[start][start]) start = c;
+        }
+        return trace;
+    }
+
+    /// Direction of greatest spread as a unit vector, by power iteration; returns the variance
+    /// along it (times the pixel count), or 0 with a zero axis when the pixels are all equal.
+    float PrincipalAxis(float (&axis)[4], u32 iterations = 8) const {
+        float cov[4][4];
+        u32 start;
+        const float trace = CovarianceMatrix(cov, start);
+        std::fill(std::begin(axis), std::end(axis), 0.0f);
+        if (trace <= 0.0f) return 0.0f;
+
+        // Scaling by the trace, which bounds every eigenvalue, keeps the iterates in range without
+        // renormalising each step.
+        const float scale = 1.0f / trace;
+        for (u32 c = 0; c < 4; ++c) axis[c] = cov[start][c] * scale;
+        for (u32 iteration = 0; iteration < iterations; ++iteration) {
+            float next[4]{};
+            for (u32 a = 0; a < 4; ++a) {
+                for (u32 b = 0; b < 4; ++b) next[a] += cov[a][b] * axis[b];
+            }
+            for (u32 c = 0; c < 4; ++c) axis[c] = next[c] * scale;
+        }
+
+        float length = 0.0f;
+        for (u32 c = 0; c < 4; ++c) length += axis[c] * axis[c];
+        if (length <= 0.0f) return 0.0f;
+        const float inv_length = 1.0f / std::sqrt(length);
+        float variance = 0.0f;
+        for (u32 a = 0; a < 4; ++a) {
+            axis[a] *= inv_length;
+        }
+        for (u32 a = 0; a < 4; ++a) {
+            float row = 0.0f;
+            for (u32 b = 0; b < 4; ++b) row += cov[a][b] * axis[b];
+            variance += row * axis[a];
+        }
+        return variance;
+    }
+
+    /// Spread left once the principal axis is taken out, which is what two endpoints can't cover.
+    /// Ranking partitions only needs a rough figure, so this takes the Rayleigh quotient after two
+    /// power steps rather than a proper axis.
+    float ResidualVariance() const {
+        float cov[4][4];
+        u32 start;
+        const float trace = CovarianceMatrix(cov, start);
+        if (trace <= 0.0f) return 0.0f;
+
+        // As in PrincipalAxis, scaling by the trace keeps the steps in range.
+        const float scale = 1.0f / trace;
+        float v[4];
+        for (u32 c = 0; c < 4; ++c) v[c] = cov[start][c] * scale;
+        for (u32 step = 0; step < 2; ++step) {
+            float next[4]{};
+            for (u32 a = 0; a < 4; ++a) {
+                for (u32 b = 0; b < 4; ++b) next[a] += cov[a][b] * v[b];
+            }
+            for (u32 c = 0; c < 4; ++c) v[c] = next[c] * scale;
+        }
+        float vv = 0.0f;
+        float v_cov_v = 0.0f;
+        for (u32 a = 0; a < 4; ++a) {
+            float row = 0.0f;
+            for (u32 b = 0; b < 4; ++b) row += cov[a][b] * v[b];
+            vv += v[a] * v[a];
+            v_cov_v += v[a] * row;
+        }
+        return vv > 0.0f ? trace - v_cov_v / vv : trace;
+    }
+
+    u32 channels;
+    float sums[TERMS]{};
+};
+
+/// Ends of the line through the pixels selected by mask, at their outermost projections onto it.
+static void FitLine(const u8* pixels, u32 mask, u32 channels, float (&lo)[4], float (&hi)[4]) {
+    const PixelStats stats(pixels, mask, channels);
+    float axis[4];
+    stats.PrincipalAxis(axis);
+
+    float t_min = 0.0f;
+    float t_max = 0.0f;
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        if (mask & (1U << i)) {
+            float t = 0.0f;
+            for (u32 c = 0; c < channels; ++c) t += (pixels[i * 4 + c] - stats.Mean(c)) * axis[c];
+            t_min = std::min(t_min, t);
+            t_max = std::max(t_max, t);
+        }
+    }
+    for (u32 c = 0; c < 4; ++c) {
+        lo[c] = c < channels ? std::clamp(stats.Mean(c) + axis[c] * t_min, 0.0f, 255.0f) : 255.0f;
+        hi[c] = c < channels ? std::clamp(stats.Mean(c) + axis[c] * t_max, 0.0f, 255.0f) : 255.0f;
+    }
+}
+
+/// Endpoints minimising the squared error of the selected pixels when pixel i sits weights[i] of
+/// the way from lo to hi. Returns false, leaving them alone, when every pixel has the same weight.
+static bool RefineEndpoints(const u8* pixels, u32 mask, u32 channels, const float (&weights)[BC_BLOCK_PIXELS],
+                            float (&lo)[4], float (&hi)[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4]{}, bx[4]{};
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        if (mask & (1U << i)) {
+            const float b = weights[i];
+            const float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (u32 c = 0; c < channels; ++c) {
+                ax[c] += a * pixels[i * 4 + c];
+                bx[c] += b * pixels[i * 4 + c];
+            }
+        }
+    }
+    const float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-4f) return false;
+    for (u32 c = 0; c < channels; ++c) {
+        lo[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+        hi[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+static u32 SquaredError(const u8* a, const u8* b, u32 channels) {
+    u32 error = 0;
+    for (u32 c = 0; c < channels; ++c) {
+        const s32 d = a[c] - b[c];
+        error += d * d;
+    }
+    return error;
+}
+
+// BC1-BC3 colour
+
+/// Endpoint pairs whose 4-colour palette entry 2 (two thirds of the first plus a third of the
+/// second) lands closest to each 8-bit value, for blocks of a single colour.
+struct SingleColorTables {
+    u8 five[256][2];
+    u8 six[256][2];
+};
+
+static const SingleColorTables& GetSingleColorTables() {
+    static const SingleColorTables tables = [] {
+        SingleColorTables t{};
+        const auto build = [](u8 (&table)[256][2], u32 bits, u32 (*expand)(u32)) {
+            for (s32 value = 0; value < 256; ++value) {
+                s32 best = 1 << 30;
+                for (u32 first = 0; first < (1U << bits); ++first) {
+                    for (u32 second = 0; second < (1U << bits); ++second) {
+                        const s32 e0 = expand(first);
+                        const s32 e1 = expand(second);
+                        // Prefer close endpoints, which hardware with coarser interpolation
+                        // reproduces best.
+                        const s32 error = std::abs((2 * e0 + e1 + 1) / 3 - value) * 256 + std::abs(e0 - e1);
+                        if (error < best) {
+                            best = error;
+                            table[value][0] = static_cast<u8>(first);
+                            table[value][1] = static_cast<u8>(second);
+                        }
+                    }
+                }
+            }
+        };
+        build(t.five, 5, Expand5);
+        build(t.six, 6, Expand6);
+        return t;
+    }();
+    return tables;
+}
+
+static u32 To565(const float (&color)[4]) {
+    const u32 r = static_cast<u32>(std::lround(color[0] * (31.0f / 255.0f)));
+    const u32 g = static_cast<u32>(std::lround(color[1] * (63.0f / 255.0f)));
+    const u32 b = static_cast<u32>(std::lround(color[2] * (31.0f / 255.0f)));
+    return (r << 11) | (g << 5) | b;
+}
+
+struct BC1Fit {
+    u32 c0;
+    u32 c1;
+    u32 indices;
+    u32 error;
+};
+
+/// Quantises two endpoints for the 4-colour palette, or the 3-colour one used with transparency,
+/// and picks the closest entry for every pixel in mask. The others get the transparent entry.
+static BC1Fit EvaluateBC1(const u8* pixels, u32 mask, const float (&e0)[4], const float (&e1)[4],
+                          bool three_colors) {
+    u32 c0 = To565(e0);
+    u32 c1 = To565(e1);
+    // The endpoint order selects the palette: c0 > c1 for four colours, c0 <= c1 for three.
+    if (three_colors ? c0 > c1 : c0 < c1) std::swap(c0, c1);
+
+    u8 palette[4][4];
+    BC1Palette(c0, c1, true, palette);
+    const u32 num_colors = c0 > c1 ? 4 : 3;
+
+    BC1Fit fit{c0, c1, 0, 0};
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        u32 index = 3;
+        if (mask & (1U << i)) {
+            u32 best = ~0U;
+            for (u32 k = 0; k < num_colors; ++k) {
+                const u32 error = SquaredError(pixels + i * 4, palette[k], 3);
+                if (error < best) {
+                    best = error;
+                    index = k;
+                }
+            }
+            fit.error += best;
+        }
+        fit.indices |= index << (i * 2);
+    }
+    return fit;
+}
+
+/// Colour half of BC1-BC3. With allow_transparent, pixels with alpha below 128 are left to the
+/// transparent entry and the rest fitted to the 3-colour palette.
+static void EncodeBC1Colors(const u8* pixels, u8* block, bool allow_transparent, u32 quality) {
+    u32 mask = 0;
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        if (!allow_transparent || pixels[i * 4 + 3] >= 128) mask |= 1U << i;
+    }
+    const bool three_colors = mask != 0xFFFF;
+
+    bool single_color = true;
+    for (u32 i = 1; i < BC_BLOCK_PIXELS; ++i) {
+        single_color &= std::memcmp(pixels, pixels + i * 4, 3) == 0;
+    }
+
+    BC1Fit best{0, 0, 0xFFFFFFFF, 0};
+    if (mask == 0) {
+        // Fully transparent, already set.
+    } else if (single_color && !three_colors) {
+        const SingleColorTables& tables = GetSingleColorTables();
+        const u8* r = tables.five[pixels[0]];
+        const u8* g = tables.six[pixels[1]];
+        const u8* b = tables.five[pixels[2]];
+        const u32 c0 = (r[0] << 11) | (g[0] << 5) | b[0];
+        const u32 c1 = (r[1] << 11) | (g[1] << 5) | b[1];
+        // Entry 2 of (c0, c1) is entry 3 of (c1, c0); equal endpoints need only entry 0.
+        best = c0 > c1 ? BC1Fit{c0, c1, 0xAAAAAAAA, 0}
+                       : c0 < c1 ? BC1Fit{c1, c0, 0xFFFFFFFF, 0} : BC1Fit{c0, c1, 0, 0};
+    } else {
+        float e0[4], e1[4];
+        FitLine(pixels, mask, 3, e1, e0);
+        best = EvaluateBC1(pixels, mask, e0, e1, three_colors);
+        // Opaque blocks can also use the 3-colour palette in BC1, which sometimes fits better.
+        if (allow_transparent && !three_colors && quality > 0) {
+            const BC1Fit alternative = EvaluateBC1(pixels, mask, e0, e1, true);
+            if (alternative.error < best.error) best = alternative;
+        }
+
+        const u32 passes = 1 + quality * 2;
+        for (u32 pass = 0; pass < passes && best.error > 0; ++pass) {
+            static constexpr float FOUR_COLOR_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+            static constexpr float THREE_COLOR_WEIGHTS[4] = {0.0f, 1.0f, 0.5f, 0.0f};
+            const bool best_three = best.c0 <= best.c1;
+            float weights[BC_BLOCK_PIXELS];
+            for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+                const u32 index = (best.indices >> (i * 2)) & 3;
+                weights[i] = best_three ? THREE_COLOR_WEIGHTS[index] : FOUR_COLOR_WEIGHTS[index];
+            }
+            if (!RefineEndpoints(pixels, mask, 3, weights, e0, e1)) break;
+            const BC1Fit refined = EvaluateBC1(pixels, mask, e0, e1, best_three);
+            if (refined.error >= best.error) break;
+            best = refined;
+        }
+    }
+
+    block[0] = static_cast<u8>(best.c0);
+    block[1] = static_cast<u8>(best.c0 >> 8);
+    block[2] = static_cast<u8>(best.c1);
+    block[3] = static_cast<u8>(best.c1 >> 8);
+    std::memcpy(block + 4, &best.indices, sizeof(best.indices));
+}
+
+// BC4 channels
+
+struct BC4Fit {
+    s32 a0;
+    s32 a1;
+    u64 indices;
+    u32 error;
+};
+
+static BC4Fit EvaluateBC4(const s32 (&values)[BC_BLOCK_PIXELS], s32 a0, s32 a1, bool is_signed) {
+    s32 palette[8];
+    BC4Palette(a0, a1, is_signed, palette);
+    BC4Fit fit{a0, a1, 0, 0};
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        u32 best = ~0U;
+        u64 index = 0;
+        for (u32 k = 0; k < 8; ++k) {
+            const s32 d = values[i] - palette[k];
+            if (static_cast<u32>(d * d) < best) {
+                best = d * d;
+                index = k;
+            }
+        }
+        fit.indices |= index << (i * 3);
+        fit.error += best;
+    }
+    return fit;
+}
+
+/// One BC4 channel (also BC3 alpha and each BC5 channel) from values in the stored range. The
+/// eight-value palette spans the block; past quality 0 the six-value one, which has the range
+/// limits as fixed entries, gets a turn on what lies between, and at quality 2 both ends are
+/// nudged inwards in case that lines the steps up better.
+static void EncodeBC4Channel(const s32 (&values)[BC_BLOCK_PIXELS], bool is_signed, u32 quality, u8* block) {
+    const s32 limit_lo = is_signed ? -127 : 0;
+    const s32 limit_hi = is_signed ? 127 : 255;
+    const auto [lo, hi] = std::minmax_element(std::begin(values), std::end(values));
+
+    BC4Fit best = EvaluateBC4(values, *hi, *lo, is_signed);
+    if (quality >= 2) {
+        for (s32 d0 = 0; d0 <= 2; ++d0) {
+            for (s32 d1 = 0; d1 <= 2; ++d1) {
+                const s32 a0 = *hi - d0;
+                const s32 a1 = *lo + d1;
+                if (a0 <= a1 || (d0 == 0 && d1 == 0)) continue;
+                const BC4Fit fit = EvaluateBC4(values, a0, a1, is_signed);
+                if (fit.error < best.error) best = fit;
+            }
+        }
+    }
+    if (quality >= 1 && best.error > 0) {
+        s32 inner_lo = limit_hi;
+        s32 inner_hi = limit_lo;
+        for (const s32 value : values) {
+            if (value != limit_lo && value != limit_hi) {
+                inner_lo = std::min(inner_lo, value);
+                inner_hi = std::max(inner_hi, value);
+            }
+        }
+        if (inner_lo > inner_hi) inner_lo = inner_hi = limit_lo;
+        const BC4Fit fit = EvaluateBC4(values, inner_lo, inner_hi, is_signed);
+        if (fit.error < best.error) best = fit;
+    }
+
+    block[0] = static_cast<u8>(best.a0);
+    block[1] = static_cast<u8>(best.a1);
+    for (u32 i = 0; i < 6; ++i) {
+        block[2 + i] = static_cast<u8>(best.indices >> (i * 8));
+    }
+}
+
+/// Reads one channel into the stored range, undoing the decoders' SNORM mapping.
+static void BC4Values(const u8* pixels, u32 channel, bool is_signed, s32 (&values)[BC_BLOCK_PIXELS]) {
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        const s32 value = pixels[i * 4 + channel];
+        values[i] = is_signed ? (value * 254 + 127) / 255 - 127 : value;
+    }
+}
+
+void EncodeBC1Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<8>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        EncodeBC1Colors(block_pixels, block, true, quality);
+    });
+}
+
+void EncodeBC2Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<16>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; i += 2) {
+            const u32 a0 = (block_pixels[i * 4 + 3] * 15 + 127) / 255;
+            const u32 a1 = (block_pixels[i * 4 + 7] * 15 + 127) / 255;
+            block[i / 2] = static_cast<u8>(a0 | (a1 << 4));
+        }
+        EncodeBC1Colors(block_pixels, block + 8, false, quality);
+    });
+}
+
+void EncodeBC3Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<16>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        s32 alpha[BC_BLOCK_PIXELS];
+        BC4Values(block_pixels, 3, false, alpha);
+        EncodeBC4Channel(alpha, false, quality, block);
+        EncodeBC1Colors(block_pixels, block + 8, false, quality);
+    });
+}
+
+template <bool SIGNED>
+static void EncodeBC4Block(const u8* pixels, u8* block, u32 quality) {
+    s32 values[BC_BLOCK_PIXELS];
+    BC4Values(pixels, 0, SIGNED, values);
+    EncodeBC4Channel(values, SIGNED, quality, block);
+}
+
+template <bool SIGNED>
+static void EncodeBC5Block(const u8* pixels, u8* block, u32 quality) {
+    s32 values[BC_BLOCK_PIXELS];
+    BC4Values(pixels, 0, SIGNED, values);
+    EncodeBC4Channel(values, SIGNED, quality, block);
+    BC4Values(pixels, 1, SIGNED, values);
+    EncodeBC4Channel(values, SIGNED, quality, block + 8);
+}
+
+void EncodeBC4URow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<8>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        EncodeBC4Block<false>(block_pixels, block, quality);
+    });
+}
+
+void EncodeBC4SRow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<8>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        EncodeBC4Block<true>(block_pixels, block, quality);
+    });
+}
+
+void EncodeBC5URow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<16>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        EncodeBC5Block<false>(block_pixels, block, quality);
+    });
+}
+
+void EncodeBC5SRow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<16>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        EncodeBC5Block<true>(block_pixels, block, quality);
+    });
+}
+
+// BC7
+
+/// One way of encoding a block: a mode, a partition and, per subset, quantised endpoints with
+/// their p-bits, plus every pixel's index.
+struct BC7Encoding {
+    u32 mode;
+    u32 partition;
+    u8 endpoints[3][2][4];
+    u8 pbits[3][2];
+    u8 indices[BC_BLOCK_PIXELS];
+    u32 error;
+};
+
+/// Value a quantised endpoint channel of `bits` bits (p-bit included) widens to.
+static u32 WidenBC7(u32 value, u32 bits) {
+    return (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+/// Closest code to every 8-bit value at each endpoint precision the encoder uses, with the squared
+/// error it leaves, indexed [bits - 4][p-bit + 1]; column 0 is for modes without p-bits.
+struct BC7QuantizeTables {
+    u8 code[4][3][256];
+    u16 error[4][3][256];
+};
+
+static const BC7QuantizeTables& GetBC7QuantizeTables() {
+    static const BC7QuantizeTables tables = [] {
+        BC7QuantizeTables t{};
+        for (u32 bits = 4; bits <= 7; ++bits) {
+            for (u32 column = 0; column < 3; ++column) {
+                const u32 total_bits = bits + (column != 0);
+                for (s32 target = 0; target < 256; ++target) {
+                    u32 best = ~0U;
+                    for (u32 code = 0; code < (1U << bits); ++code) {
+                        const u32 value = column != 0 ? (code << 1) | (column - 1) : code;
+                        const s32 d = static_cast<s32>(WidenBC7(value, total_bits)) - target;
+                        if (static_cast<u32>(d * d) < best) {
+                            best = d * d;
+                            t.code[bits - 4][column][target] = static_cast<u8>(code);
+                            t.error[bits - 4][column][target] = static_cast<u16>(best);
+                        }
+                    }
+                }
+            }
+        }
+        return t;
+    }();
+    return tables;
+}
+
+/// Quantises one endpoint, pbit being -1 in modes without p-bits, and returns its squared error.
+static u32 QuantizeBC7Endpoint(const BC7QuantizeTables& tables, const BC7Mode& mode, const float (&target)[4],
+                               s32 pbit, u8 (&codes)[4]) {
+    u32 total = 0;
+    for (u32 c = 0; c < 4; ++c) {
+        const u32 bits = c < 3 ? mode.color_bits : mode.alpha_bits;
+        if (bits == 0) {
+            codes[c] = 0;
+            continue;
+        }
+        const u32 value = static_cast<u32>(target[c] + 0.5f);
+        codes[c] = tables.code[bits - 4][pbit + 1][value];
+        total += tables.error[bits - 4][pbit + 1][value];
+    }
+    return total;
+}
+
+/// Endpoint colours a subset decodes to, p-bits and all.
+static void WidenBC7Endpoints(const BC7Mode& mode, const u8 (&codes)[2][4], const u8 (&pbits)[2],
+                              u32 (&endpoints)[2][4]) {
+    const u32 pbit_count = mode.endpoint_pbits | mode.shared_pbits;
+    for (u32 e = 0; e < 2; ++e) {
+        for (u32 c = 0; c < 4; ++c) {
+            const u32 bits = c < 3 ? mode.color_bits : mode.alpha_bits;
+            if (bits == 0) {
+                endpoints[e][c] = 255;
+                continue;
+            }
+            const u32 value = pbit_count ? (codes[e][c] << 1) | pbits[e] : codes[e][c];
+            endpoints[e][c] = WidenBC7(value, bits + pbit_count);
+        }
+    }
+}
+
+/// A subset's quantised endpoints and the indices and error they give its pixels.
+struct BC7SubsetFit {
+    u8 codes[2][4];
+    u8 pbits[2];
+    u8 indices[BC_BLOCK_PIXELS];
+    u32 error;
+};
+
+/// Quantises lo/hi for a mode, choosing the p-bits closest to them (or, with exhaustive_pbits,
+/// the ones giving the lowest pixel error), then indexes every pixel of the subset.
+static BC7SubsetFit EvaluateBC7Subset(const u8* pixels, u32 mask, const BC7Mode& mode, const float (&lo)[4],
+                                      const float (&hi)[4], bool exhaustive_pbits) {
+    // Both endpoints quantised with either p-bit, then the pairs a mode allows: none, one shared
+    // per subset, or one per endpoint.
+    const BC7QuantizeTables& tables = GetBC7QuantizeTables();
+    const bool has_pbits = mode.endpoint_pbits || mode.shared_pbits;
+    u8 codes[2][2][4];
+    u32 errors[2][2]{};
+    for (u32 pbit = 0; pbit < (has_pbits ? 2U : 1U); ++pbit) {
+        const s32 column = has_pbits ? static_cast<s32>(pbit) : -1;
+        errors[0][pbit] = QuantizeBC7Endpoint(tables, mode, lo, column, codes[0][pbit]);
+        errors[1][pbit] = QuantizeBC7Endpoint(tables, mode, hi, column, codes[1][pbit]);
+    }
+
+    u32 pbit_pairs[4][2]{};
+    u32 num_pairs = 1;
+    if (mode.shared_pbits) {
+        pbit_pairs[1][0] = pbit_pairs[1][1] = 1;
+        num_pairs = 2;
+    } else if (mode.endpoint_pbits) {
+        for (u32 i = 0; i < 4; ++i) {
+            pbit_pairs[i][0] = i & 1;
+            pbit_pairs[i][1] = i >> 1;
+        }
+        num_pairs = 4;
+    }
+
+    u32 candidates[4];
+    u32 num_candidates = 0;
+    if (exhaustive_pbits || num_pairs == 1) {
+        for (u32 i = 0; i < num_pairs; ++i) candidates[num_candidates++] = i;
+    } else {
+        u32 best_pair = 0;
+        u32 best_error = ~0U;
+        for (u32 i = 0; i < num_pairs; ++i) {
+            const u32 error = errors[0][pbit_pairs[i][0]] + errors[1][pbit_pairs[i][1]];
+            if (error < best_error) {
+                best_error = error;
+                best_pair = i;
+            }
+        }
+        candidates[num_candidates++] = best_pair;
+    }
+
+    const u8* const weights = Weights(mode.index_bits);
+    const u32 num_indices = 1U << mode.index_bits;
+    const u32 channels = mode.alpha_bits ? 4 : 3;
+    BC7SubsetFit best{};
+    best.error = ~0U;
+    for (u32 candidate = 0; candidate < num_candidates; ++candidate) {
+        BC7SubsetFit fit{};
+        const u32 pair = candidates[candidate];
+        fit.pbits[0] = static_cast<u8>(pbit_pairs[pair][0]);
+        fit.pbits[1] = static_cast<u8>(pbit_pairs[pair][1]);
+        std::memcpy(fit.codes[0], codes[0][fit.pbits[0]], 4);
+        std::memcpy(fit.codes[1], codes[1][fit.pbits[1]], 4);
+
+        u32 endpoints[2][4];
+        WidenBC7Endpoints(mode, fit.codes, fit.pbits, endpoints);
+        u8 palette[16][4];
+        for (u32 k = 0; k < num_indices; ++k) {
+            for (u32 c = 0; c < 4; ++c) {
+                palette[k][c] = static_cast<u8>(Interpolate(endpoints[0][c], endpoints[1][c], weights[k]));
+            }
+        }
+        // The weights are close to evenly spaced, so the pixel's position along the endpoint line
+        // narrows its index down to one of three.
+        s32 direction[4];
+        s32 length = 0;
+        for (u32 c = 0; c < channels; ++c) {
+            direction[c] = static_cast<s32>(endpoints[1][c]) - static_cast<s32>(endpoints[0][c]);
+            length += direction[c] * direction[c];
+        }
+        const float scale = length > 0 ? static_cast<float>(num_indices - 1) / length : 0.0f;
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            if (!(mask & (1U << i))) continue;
+            s32 dot = 0;
+            for (u32 c = 0; c < channels; ++c) {
+                dot += (pixels[i * 4 + c] - static_cast<s32>(endpoints[0][c])) * direction[c];
+            }
+            const s32 guess = static_cast<s32>(std::lround(dot * scale));
+            const u32 first = static_cast<u32>(std::clamp(guess - 1, 0, static_cast<s32>(num_indices) - 1));
+            const u32 last = static_cast<u32>(std::clamp(guess + 1, 0, static_cast<s32>(num_indices) - 1));
+            u32 pixel_best = ~0U;
+            for (u32 k = first; k <= last; ++k) {
+                const u32 error = SquaredError(pixels + i * 4, palette[k], channels);
+                if (error < pixel_best) {
+                    pixel_best = error;
+                    fit.indices[i] = static_cast<u8>(k);
+                }
+            }
+            fit.error += pixel_best;
+        }
+        if (fit.error < best.error) best = fit;
+    }
+    return best;
+}
+
+/// Fits one subset: the principal axis first, then least-squares passes while they help.
+static BC7SubsetFit FitBC7Subset(const u8* pixels, u32 mask, const BC7Mode& mode, u32 passes,
+                                 bool exhaustive_pbits) {
+    const u32 channels = mode.alpha_bits ? 4 : 3;
+    float lo[4], hi[4];
+    FitLine(pixels, mask, channels, lo, hi);
+    BC7SubsetFit best = EvaluateBC7Subset(pixels, mask, mode, lo, hi, exhaustive_pbits);
+
+    const u8* const weights = Weights(mode.index_bits);
+    for (u32 pass = 0; pass < passes && best.error > 0; ++pass) {
+        float pixel_weights[BC_BLOCK_PIXELS];
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            pixel_weights[i] = weights[best.indices[i]] / 64.0f;
+        }
+        if (!RefineEndpoints(pixels, mask, channels, pixel_weights, lo, hi)) break;
+        const BC7SubsetFit refined = EvaluateBC7Subset(pixels, mask, mode, lo, hi, exhaustive_pbits);
+        if (refined.error >= best.error) break;
+        best = refined;
+    }
+    return best;
+}
+
+/// Pixels of each subset of every partition, [num_subsets - 2][partition][subset].
+constexpr auto BC7_SUBSET_MASKS = [] {
+    std::array<std::array<std::array<u16, 3>, 64>, 2> masks{};
+    for (u32 partition = 0; partition < 64; ++partition) {
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            masks[0][partition][BC7_PARTITIONS_2[partition][i]] |= static_cast<u16>(1U << i);
+            masks[1][partition][BC7_PARTITIONS_3[partition][i]] |= static_cast<u16>(1U << i);
+        }
+    }
+    return masks;
+}();
+
+static u32 SubsetMask(u32 num_subsets, u32 partition, u32 subset) {
+    return num_subsets == 1 ? 0xFFFF : BC7_SUBSET_MASKS[num_subsets - 2][partition][subset];
+}
+
+static BC7Encoding EncodeBC7Partition(const u8* pixels, u32 mode_index, u32 partition, u32 passes,
+                                      bool exhaustive_pbits) {
+    const BC7Mode& mode = BC7_MODES[mode_index];
+    BC7Encoding encoding{};
+    encoding.mode = mode_index;
+    encoding.partition = partition;
+    for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+        const u32 mask = SubsetMask(mode.num_subsets, partition, subset);
+        const BC7SubsetFit fit = FitBC7Subset(pixels, mask, mode, passes, exhaustive_pbits);
+        std::memcpy(encoding.endpoints[subset], fit.codes, sizeof(fit.codes));
+        std::memcpy(encoding.pbits[subset], fit.pbits, sizeof(fit.pbits));
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            if (mask & (1U << i)) encoding.indices[i] = fit.indices[i];
+        }
+        encoding.error += fit.error;
+    }
+    return encoding;
+}
+
+/// The `count` partitions (of the first `available`) whose subsets leave the least spread off
+/// their principal axes, best first.
+static u32 BestBC7Partitions(const u8* pixels, u32 num_subsets, u32 available, u32 channels, u32 count,
+                             u32* partitions) {
+    float terms[BC_BLOCK_PIXELS][PixelStats::TERMS];
+    PixelStats::PixelTerms(pixels, terms);
+    const PixelStats block(terms, 0xFFFF, channels);
+    std::pair<float, u32> scores[64];
+    for (u32 partition = 0; partition < available; ++partition) {
+        PixelStats last = block;
+        float score = 0.0f;
+        for (u32 subset = 0; subset + 1 < num_subsets; ++subset) {
+            const PixelStats stats(terms, SubsetMask(num_subsets, partition, subset), channels);
+            score += stats.ResidualVariance();
+            last -= stats;
+        }
+        scores[partition] = {score + last.ResidualVariance(), partition};
+    }
+    count = std::min(count, available);
+    std::partial_sort(scores, scores + count, scores + available);
+    for (u32 i = 0; i < count; ++i) partitions[i] = scores[i].second;
+    return count;
+}
+
+static void PackBC7(BC7Encoding& encoding, u8* block) {
+    const BC7Mode& mode = BC7_MODES[encoding.mode];
+    const u32 max_index = (1U << mode.index_bits) - 1;
+
+    // The anchor pixel of each subset stores its index without the top bit, so that bit must be
+    // 0; the weights are symmetric, so swapping the endpoints and flipping the indices is free.
+    const u32 anchors[3] = {0,
+                            mode.num_subsets == 2 ? BC7_ANCHORS_2[encoding.partition]
+                                                  : BC7_ANCHORS_3_SECOND[encoding.partition],
+                            BC7_ANCHORS_3_THIRD[encoding.partition]};
+    for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+        if (encoding.indices[anchors[subset]] <= max_index / 2) continue;
+        std::swap(encoding.endpoints[subset][0], encoding.endpoints[subset][1]);
+        std::swap(encoding.pbits[subset][0], encoding.pbits[subset][1]);
+        for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+            if (Subset(mode.num_subsets, encoding.partition, i) == subset) {
+                encoding.indices[i] = static_cast<u8>(max_index - encoding.indices[i]);
+            }
+        }
+    }
+
+    BlockBitWriter bits;
+    bits.Write(1U << encoding.mode, encoding.mode + 1);
+    bits.Write(encoding.partition, mode.partition_bits);
+    for (u32 channel = 0; channel < 4; ++channel) {
+        const u32 channel_bits = channel < 3 ? mode.color_bits : mode.alpha_bits;
+        for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+            bits.Write(encoding.endpoints[subset][0][channel], channel_bits);
+            bits.Write(encoding.endpoints[subset][1][channel], channel_bits);
+        }
+    }
+    for (u32 subset = 0; subset < mode.num_subsets; ++subset) {
+        if (mode.endpoint_pbits) {
+            bits.Write(encoding.pbits[subset][0], 1);
+            bits.Write(encoding.pbits[subset][1], 1);
+        } else if (mode.shared_pbits) {
+            bits.Write(encoding.pbits[subset][0], 1);
+        }
+    }
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        bits.Write(encoding.indices[i], mode.index_bits - IsAnchor(mode.num_subsets, encoding.partition, i));
+    }
+    bits.Store(block);
+}
+
+static void EncodeBC7Block(const u8* pixels, u8* block, u32 quality) {
+    bool opaque = true;
+    for (u32 i = 0; i < BC_BLOCK_PIXELS; ++i) {
+        opaque &= pixels[i * 4 + 3] == 255;
+    }
+
+    const u32 passes = quality == 0 ? 1 : quality == 1 ? 2 : 4;
+    const bool exhaustive_pbits = quality >= 2;
+    BC7Encoding best = EncodeBC7Partition(pixels, 6, 0, passes, exhaustive_pbits);
+
+    // Tries a mode on the `count` partitions most likely to suit it.
+    const auto try_mode = [&](u32 mode_index, u32 count) {
+        if (best.error == 0) return;
+        const BC7Mode& mode = BC7_MODES[mode_index];
+        u32 partitions[64];
+        count = BestBC7Partitions(pixels, mode.num_subsets, 1U << mode.partition_bits, opaque ? 3 : 4, count,
+                                  partitions);
+        for (u32 i = 0; i < count && best.error > 0; ++i) {
+            const BC7Encoding encoding = EncodeBC7Partition(pixels, mode_index, partitions[i], passes, exhaustive_pbits);
+            if (encoding.error < best.error) best = encoding;
+        }
+    };
+
+    // Modes 0-3 have no alpha, so only opaque blocks can use them.
+    if (quality == 1) {
+        try_mode(opaque ? 1 : 7, 4);
+    } else if (quality >= 2) {
+        if (opaque) {
+            try_mode(1, 8);
+            try_mode(3, 8);
+            try_mode(2, 4);
+            try_mode(0, 4);
+        } else {
+            try_mode(7, 8);
+        }
+    }
+
+    PackBC7(best, block);
+}
+
+void EncodeBC7Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality) {
+    EncodeRow<16>(pixels, pitch, count, blocks, [quality](const u8* block_pixels, u8* block) {
+        EncodeBC7Block(block_pixels, block, quality);
+    });
+}
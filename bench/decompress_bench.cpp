@@ -0,0 +1,112 @@
+// Throughput of decompress against decompress_safe on the same type 4 streams.
+//
+//   bench_decompress [blob...]
+//
+// Each argument is a YKCMP file to decode; without any, a 64 MiB synthetic stream of short matches
+// and literal runs is compressed first. The decoders take turns over several runs per input and
+// each one's fastest run counts, reported as decompressed bytes per second. Build it from the
+// repository root with
+//
+//   g++ -O3 -std=c++20 -I. bench/decompress_bench.cpp Util.cpp compress.cpp lz4.c -o bench_decompress
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include "ykcmp.h"
+
+/// Timed runs per decoder and input.
+constexpr int BENCH_RUNS = 20;
+constexpr u32 SYNTHETIC_SIZE = 64U << 20;
+
+/// Text-like data: words from a small vocabulary with the odd random byte, so the stream mixes
+/// every match form with literal runs the way game data does.
+static std::vector<u8> MakeSynthetic() {
+    static const char* const words[] = {"texture", "model",  "script", "0x00",  "param", "effect",
+                                        "sound",   "player", "enemy",  "table", "index", "value"};
+    std::mt19937 rng{1};
+    std::vector<u8> data;
+    data.reserve(SYNTHETIC_SIZE);
+    while (data.size() < SYNTHETIC_SIZE) {
+        if (rng() % 8 == 0) {
+            data.push_back(static_cast<u8>(rng()));
+        } else {
+            const char* word = words[rng() % std::size(words)];
+            data.insert(data.end(), word, word + std::strlen(word));
+            data.push_back(' ');
+        }
+    }
+    data.resize(SYNTHETIC_SIZE);
+
+    std::vector<u8> blob(compress_bound(SYNTHETIC_SIZE));
+    const s32 size = compress(data.data(), SYNTHETIC_SIZE, blob.data(), static_cast<u32>(blob.size()), 5);
+    blob.resize(size > 0 ? size : 0);
+    return blob;
+}
+
+static std::vector<u8> ReadFile(const char* path) {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+/// Seconds one call of decode takes.
+template <typename Decode>
+static double Time(Decode&& decode) {
+    const auto start = std::chrono::steady_clock::now();
+    decode();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool Bench(const std::string& name, std::vector<u8> blob) {
+    if (blob.size() < sizeof(YKCMP_HDR)) {
+        std::fprintf(stderr, "%s: not a YKCMP blob\n", name.c_str());
+        return false;
+    }
+    YKCMP_HDR hdr{};
+    std::memcpy(&hdr, blob.data(), sizeof(YKCMP_HDR));
+    const u32 in_size = static_cast<u32>(blob.size());
+
+    std::vector<u8> expected(hdr.decompSize);
+    if (decompress_safe(blob.data(), in_size, expected.data(), hdr.decompSize) != YKCMP_OK) {
+        std::fprintf(stderr, "%s: does not decode\n", name.c_str());
+        return false;
+    }
+
+    // The decoders take turns so that clock and cache drift hits both alike.
+    std::vector<u8> out(hdr.decompSize);
+    double safe_seconds = 1e9;
+    double fast_seconds = 1e9;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        safe_seconds = std::min(safe_seconds, Time([&] {
+            decompress_safe(blob.data(), in_size, out.data(), hdr.decompSize);
+        }));
+        fast_seconds = std::min(fast_seconds, Time([&] {
+            decompress(blob.data(), in_size, out.data(), hdr.decompSize);
+        }));
+    }
+    const double safe = hdr.decompSize / safe_seconds / 1e9;
+    const double fast = hdr.decompSize / fast_seconds / 1e9;
+    if (out != expected) {
+        std::fprintf(stderr, "%s: decompress and decompress_safe disagree\n", name.c_str());
+        return false;
+    }
+    std::printf("%s: %u -> %u bytes, decompress %.2f GB/s, decompress_safe %.2f GB/s (%+.1f%%)\n", name.c_str(),
+                in_size, hdr.decompSize, fast, safe, (safe / fast - 1.0) * 100.0);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool ok = true;
+    if (argc < 2) {
+        ok = Bench("synthetic", MakeSynthetic());
+    }
+    for (int i = 1; i < argc; ++i) {
+        ok &= Bench(argv[i], ReadFile(argv[i]));
+    }
+    return ok ? 0 : 1;
+}
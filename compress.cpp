@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "ykcmp.h"
+
+struct Type4Match {
+    u32 offset;
+    u32 length;
+};
+
+/// Bytes the cheapest token that can encode this back-reference takes, or 0 if none can.
+[[nodiscard]] constexpr u32 Type4MatchCost(u32 offset, u32 length) {
+    if (offset <= TYPE4_MAX_SHORT_OFFSET && length <= TYPE4_MAX_SHORT_MATCH) return 1;
+    if (offset <= TYPE4_MAX_MEDIUM_OFFSET && length >= TYPE4_MIN_MEDIUM_MATCH &&
+        length <= TYPE4_MAX_MEDIUM_MATCH) {
+        return 2;
+    }
+    if (length >= TYPE4_MIN_MATCH) return 3;
+    return 0;
+}
+
+/// Output bytes saved by encoding a match instead of its literals (ignoring literal run headers).
+[[nodiscard]] constexpr s32 Type4MatchGain(Type4Match match) {
+    const u32 cost = Type4MatchCost(match.offset, match.length);
+    return cost == 0 ? 0 : static_cast<s32>(match.length) - static_cast<s32>(cost);
+}
+
+struct Type4Level {
+    u32 max_chain;   ///< Hash chain candidates visited per position
+    u32 nice_length; ///< A match at least this long is taken without searching further
+    bool lazy;       ///< Check whether the next position starts a better match before committing
+};
+
+constexpr std::array<Type4Level, TYPE4_LEVEL_OPTIMAL> TYPE4_LEVELS = { {
+    {0, 0, false},     // 0: literals only
+    {4, 16, false},
+    {8, 32, false},
+    {16, 32, false},
+    {16, 64, true},
+    {32, 128, true},
+    {64, 128, true},
+    {128, 256, true},
+    {256, TYPE4_MAX_MATCH, true},
+    {1024, TYPE4_MAX_MATCH, true},
+} };
+
+/// Hash chains over 3-byte prefixes, limited to the 4 KiB type 4 window. Each chain link stores the
+/// distance back to the previous position with the same hash, like lz4hc's chainTable.
+class Type4MatchFinder {
+public:
+    Type4MatchFinder(const u8* data, u32 size) : data(data), size(size), head(HASH_SIZE, NONE),
+                                                 chain(TYPE4_WINDOW_SIZE, 0) {}
+
+    /// Adds every position before pos to the chains.
+    void InsertUpTo(u32 pos) {
+        const u32 end = std::min(pos, size >= TYPE4_MIN_MATCH ? size - TYPE4_MIN_MATCH + 1 : 0);
+        for (; next_insert < end; ++next_insert) {
+            const u32 hash = Hash(&data[next_insert]);
+            const u32 previous = head[hash];
+            const u32 delta = previous == NONE ? 0 : next_insert - previous;
+            chain[next_insert & (TYPE4_WINDOW_SIZE - 1)] =
+                static_cast<u16>(delta > TYPE4_WINDOW_SIZE ? 0 : delta);
+            head[hash] = next_insert;
+        }
+    }
+
+    /// Length of the common prefix of pos and candidate, up to limit.
+    [[nodiscard]] u32 MatchLength(u32 pos, u32 candidate, u32 limit) const {
+        u32 length = 0;
+        while (length + 8 <= limit) {
+            u64 a, b;
+            memcpy(&a, &data[pos + length], 8);
+            memcpy(&b, &data[candidate + length], 8);
+            if (const u64 diff = a ^ b; diff != 0) {
+                return length + (std::countr_zero(diff) >> 3);
+            }
+            length += 8;
+        }
+        while (length < limit && data[pos + length] == data[candidate + length]) {
+            ++length;
+        }
+        return length;
+    }
+
+    /// Calls visit(offset, length) for the short-offset candidates and then the hash chain at pos,
+    /// nearest first, stopping early once visit returns false.
+    template <typename Visitor>
+    void ForEachCandidate(u32 pos, u32 max_chain, Visitor&& visit) {
+        const u32 limit = std::min(TYPE4_MAX_MATCH, size - pos);
+        if (limit == 0) return;
+
+        // Offsets up to 16 are cheap enough that even 2-byte matches pay off, so try them all
+        // directly rather than relying on the 3-byte hash.
+        // Offsets are gathered into a bitmask first; the fixed-count loop vectorises well.
+        if (limit >= 2 && pos >= TYPE4_MAX_SHORT_OFFSET) {
+            const u8* p = &data[pos];
+            u32 offsets = 0;
+            for (u32 offset = 1; offset <= TYPE4_MAX_SHORT_OFFSET; ++offset) {
+                offsets |= static_cast<u32>((p[-static_cast<s32>(offset)] == p[0]) &
+                                            (p[1 - static_cast<s32>(offset)] == p[1])) << offset;
+            }
+            for (; offsets != 0; offsets &= offsets - 1) {
+                const u32 offset = std::countr_zero(offsets);
+                if (!visit(offset, MatchLength(pos, pos - offset, limit))) return;
+            }
+        } else if (limit >= 2) {
+            for (u32 offset = 1; offset <= pos; ++offset) {
+                if (data[pos] != data[pos - offset] || data[pos + 1] != data[pos + 1 - offset]) continue;
+                if (!visit(offset, MatchLength(pos, pos - offset, limit))) return;
+            }
+        }
+
+        InsertUpTo(pos);
+        if (limit < TYPE4_MIN_MATCH) return;
+
+        u32 candidate = head[Hash(&data[pos])];
+        for (u32 depth = 0; depth < max_chain && candidate != NONE; ++depth) {
+            const u32 offset = pos - candidate;
+            if (offset > TYPE4_WINDOW_SIZE) break;
+            if (offset > TYPE4_MAX_SHORT_OFFSET) {
+                if (!visit(offset, MatchLength(pos, candidate, limit))) return;
+            }
+            const u16 delta = chain[candidate & (TYPE4_WINDOW_SIZE - 1)];
+            if (delta == 0 || delta > candidate) break;
+            candidate -= delta;
+        }
+    }
+
+    /// Best match at pos by bytes saved, preferring the longer one on ties.
+    [[nodiscard]] Type4Match Find(u32 pos, const Type4Level& level) {
+        Type4Match best{0, 0};
+        s32 best_gain = 0;
+        ForEachCandidate(pos, level.max_chain, [&](u32 offset, u32 length) {
+            const Type4Match match{offset, length};
+            const s32 gain = Type4MatchGain(match);
+            if (gain > best_gain || (gain == best_gain && gain > 0 && length > best.length)) {
+                best = match;
+                best_gain = gain;
+            }
+            return length < level.nice_length;
+        });
+        return best;
+    }
+
+private:
+    static constexpr u32 HASH_LOG = 15;
+    static constexpr u32 HASH_SIZE = 1U << HASH_LOG;
+    static constexpr u32 NONE = ~0U;
+
+    [[nodiscard]] static u32 Hash(const u8* p) {
+        const u32 value = p[0] | (p[1] << 8) | (p[2] << 16);
+        return (value * 2654435761U) >> (32 - HASH_LOG);
+    }
+
+    const u8* data;
+    u32 size;
+    u32 next_insert = 0;
+    std::vector<u32> head;
+    std::vector<u16> chain;
+};
+
+/// Bounds-checked token writer. Once a write would not fit, every later write is dropped and
+/// overflowed is set.
+class Type4Writer {
+public:
+    Type4Writer(u8* out, size_t out_cap, size_t pos) : out(out), out_cap(out_cap), pos(pos) {}
+
+    void PutLiterals(const u8* src, u32 size) {
+        while (size > 0) {
+            const u32 run = std::min(size, TYPE4_MAX_LITERAL);
+            if (!Reserve(1 + run)) return;
+            out[pos++] = static_cast<u8>(run);
+            memcpy(&out[pos], src, run);
+            pos += run;
+            src += run;
+            size -= run;
+        }
+    }
+
+    void PutMatch(Type4Match match) {
+        const u32 cost = Type4MatchCost(match.offset, match.length);
+        if (!Reserve(cost)) return;
+        const u32 offset = match.offset - 1;
+        const u32 length = match.length;
+        switch (cost) {
+            case 1:
+                out[pos++] = static_cast<u8>(0x80 | ((length - 1) << 4) | offset);
+                break;
+            case 2:
+                out[pos++] = static_cast<u8>(0xC0 + length - TYPE4_MIN_MEDIUM_MATCH);
+                out[pos++] = static_cast<u8>(offset);
+                break;
+            default:
+            {
+                const u32 size = length - TYPE4_MIN_MATCH;
+                out[pos++] = static_cast<u8>(0xE0 + (size >> 4));
+                out[pos++] = static_cast<u8>(((size & 0xF) << 4) | (offset >> 8));
+                out[pos++] = static_cast<u8>(offset);
+                break;
+            }
+        }
+    }
+
+    [[nodiscard]] bool Overflowed() const {
+        return overflowed;
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return pos;
+    }
+
+private:
+    bool Reserve(size_t bytes) {
+        if (overflowed || out_cap - pos < bytes) {
+            overflowed = true;
+            return false;
+        }
+        return true;
+    }
+
+    u8* out;
+    size_t out_cap;
+    size_t pos;
+    bool overflowed = false;
+};
+
+/// Greedy (optionally lazy) parse: take the best match at each position, emitting literals in
+/// between.
+static void CompressType4Greedy(const u8* in, u32 in_size, Type4Writer& writer, const Type4Level& level) {
+    if (level.max_chain == 0) {
+        writer.PutLiterals(in, in_size);
+        return;
+    }
+
+    Type4MatchFinder finder(in, in_size);
+    u32 pos = 0;
+    u32 literal_start = 0;
+
+    while (pos < in_size && !writer.Overflowed()) {
+        Type4Match match = finder.Find(pos, level);
+        if (Type4MatchGain(match) <= 0) {
+            ++pos;
+            continue;
+        }
+
+        while (level.lazy && match.length < level.nice_length && pos + 1 < in_size) {
+            const Type4Match next = finder.Find(pos + 1, level);
+            if (Type4MatchGain(next) <= Type4MatchGain(match)) break;
+            match = next;
+            ++pos;
+        }
+
+        writer.PutLiterals(&in[literal_start], pos - literal_start);
+        writer.PutMatch(match);
+        pos += match.length;
+        literal_start = pos;
+    }
+
+    writer.PutLiterals(&in[literal_start], in_size - literal_start);
+}
+
+// The optimal parse runs over blocks of this many bytes so its per-position table stays bounded;
+// matches still reach back across block boundaries.
+constexpr u32 TYPE4_OPTIMAL_BLOCK_SIZE = 1U << 18;
+constexpr Type4Level TYPE4_OPTIMAL_LEVEL = {256, 128, false};
+
+/// Cheapest known way to reach a position: from a literal run (offset 0) or a match starting at
+/// position from.
+struct Type4Step {
+    u32 cost;
+    u32 from;
+    u16 offset;
+    u16 length;
+};
+
+/// Minimum-size parse. Token costs are fixed (1 + N for N literals, 1/2/3 bytes per match form), so a
+/// shortest path over positions gives the smallest encoding the match finder can see.
+static void CompressType4Optimal(const u8* in, u32 in_size, Type4Writer& writer) {
+    Type4MatchFinder finder(in, in_size);
+    std::vector<Type4Step> steps(std::min(in_size, TYPE4_OPTIMAL_BLOCK_SIZE) + 1);
+    std::vector<Type4Step> path;
+    std::deque<u32> literal_from;
+
+    for (u32 start = 0; start < in_size && !writer.Overflowed(); start += TYPE4_OPTIMAL_BLOCK_SIZE) {
+        const u32 size = std::min(in_size - start, TYPE4_OPTIMAL_BLOCK_SIZE);
+        std::fill_n(steps.begin(), size + 1, Type4Step{~0U, 0, 0, 0});
+        steps[0].cost = 0;
+        literal_from.clear();
+        u32 search_from = 0;
+
+        for (u32 pos = 0; pos <= size; ++pos) {
+            // Best literal run ending here: minimise cost[i] + 1 + (pos - i) over the last 127
+            // positions with a monotonic queue of cost[i] - i.
+            while (!literal_from.empty() && pos - literal_from.front() > TYPE4_MAX_LITERAL) {
+                literal_from.pop_front();
+            }
+            if (!literal_from.empty()) {
+                const u32 from = literal_from.front();
+                const u32 cost = steps[from].cost + 1 + (pos - from);
+                if (cost < steps[pos].cost) steps[pos] = {cost, from, 0, 0};
+            }
+            if (pos == size) break;
+
+            const s64 key = static_cast<s64>(steps[pos].cost) - pos;
+            while (!literal_from.empty() &&
+                   static_cast<s64>(steps[literal_from.back()].cost) - literal_from.back() >= key) {
+                literal_from.pop_back();
+            }
+            literal_from.push_back(pos);
+
+            // Inside a long match already taken, skip the search; this keeps runs of flat data
+            // linear instead of relaxing every length at every position.
+            if (pos < search_from) continue;
+
+            // Candidates arrive nearest first and costs only grow with distance, so each length is
+            // relaxed by the first candidate that reaches it.
+            u32 covered = 0;
+            finder.ForEachCandidate(start + pos, TYPE4_OPTIMAL_LEVEL.max_chain, [&](u32 offset, u32 length) {
+                length = std::min(length, size - pos);
+                for (u32 l = covered + 1; l <= length; ++l) {
+                    const u32 token = Type4MatchCost(offset, l);
+                    if (token == 0) continue;
+                    const u32 cost = steps[pos].cost + token;
+                    if (cost < steps[pos + l].cost) {
+                        steps[pos + l] = {cost, pos, static_cast<u16>(offset), static_cast<u16>(l)};
+                    }
+                }
+                covered = std::max(covered, length);
+                if (length >= TYPE4_OPTIMAL_LEVEL.nice_length) {
+                    search_from = pos + length;
+                    return false;
+                }
+                return true;
+            });
+        }
+
+        path.clear();
+        for (u32 pos = size; pos > 0; pos = steps[pos].from) {
+            path.push_back(steps[pos]);
+            path.back().length = static_cast<u16>(pos - steps[pos].from);
+        }
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            if (it->offset == 0) {
+                writer.PutLiterals(&in[start + it->from], it->length);
+            } else {
+                writer.PutMatch({it->offset, it->length});
+            }
+        }
+    }
+}
+
+extern "C" YKCMP_API
+u32 compress_bound(u32 in_size) {
+    return sizeof(YKCMP_HDR) + in_size + (in_size + TYPE4_MAX_LITERAL - 1) / TYPE4_MAX_LITERAL;
+}
+
+extern "C" YKCMP_API
+s32 compress(const u8* in, u32 in_size, u8* out, u32 out_cap, s32 level) {
+    if (out_cap < sizeof(YKCMP_HDR)) return YKCMP_ERROR_OUTPUT_OVERRUN;
+
+    Type4Writer writer(out, out_cap, sizeof(YKCMP_HDR));
+    if (level >= TYPE4_LEVEL_OPTIMAL) {
+        CompressType4Optimal(in, in_size, writer);
+    } else {
+        CompressType4Greedy(in, in_size, writer, TYPE4_LEVELS[std::max(level, 0)]);
+    }
+    if (writer.Overflowed()) return YKCMP_ERROR_OUTPUT_OVERRUN;
+
+    // compSize counts the header too, matching how decompress walks the input from 0x14 to in_size.
+    YKCMP_HDR hdr{};
+    memcpy(hdr.magic, YKCMP_MAGIC, sizeof(YKCMP_MAGIC));
+    hdr.compType = 4;
+    hdr.compSize = static_cast<u32>(writer.Size());
+    hdr.decompSize = in_size;
+    memcpy(out, &hdr, sizeof(YKCMP_HDR));
+
+    return static_cast<s32>(writer.Size());
+}
@@ -0,0 +1,343 @@
+// Row converters for the uncompressed formats. Formats of up to 8 bits per channel convert to
+// RGBA8 and everything else to RGBA32F. Missing colour channels read as 0 and missing alpha as 1.
+// UNORM values scale exactly (v / max, rounded), SNORM maps -1..1 onto 0..255 in RGBA8 like the
+// BC4/BC5 decoders, and integer formats keep their values as floats. Every converter is a plain
+// loop over one pixel type, which compilers vectorise.
+
+#include <algorithm>
+#include <bit>
+#include "decode.h"
+
+struct RGBA8 {
+    u8 r, g, b, a;
+};
+
+struct RGBA32F {
+    float r, g, b, a;
+};
+
+struct U32x4 {
+    u32 v[4];
+};
+
+/// Converts count pixels of type In to Out with convert.
+template <typename In, typename Out, Out (*Convert)(In)>
+static void ConvertRow(const u8* pixels, u32 count, u8* out, u32, Extent2D) {
+    for (u32 i = 0; i < count; ++i) {
+        In pixel;
+        std::memcpy(&pixel, pixels + i * sizeof(In), sizeof(In));
+        const Out converted = Convert(pixel);
+        // Stored channel by channel; a whole-struct copy defeats the vectoriser.
+        u8* dst = out + static_cast<size_t>(i) * sizeof(Out);
+        constexpr size_t CHANNEL = sizeof(converted.r);
+        std::memcpy(dst, &converted.r, CHANNEL);
+        std::memcpy(dst + CHANNEL, &converted.g, CHANNEL);
+        std::memcpy(dst + 2 * CHANNEL, &converted.b, CHANNEL);
+        std::memcpy(dst + 3 * CHANNEL, &converted.a, CHANNEL);
+    }
+}
+
+template <typename In, typename Out, Out (*Convert)(In)>
+constexpr PixelDecoder CONVERTER{ConvertRow<In, Out, Convert>, sizeof(Out)};
+
+template <u32 BITS>
+static u8 UnormToByte(u32 value) {
+    constexpr u32 MAX = (1U << BITS) - 1;
+    return static_cast<u8>(((value & MAX) * 255 + MAX / 2) / MAX);
+}
+
+static u8 SnormToByte(u32 value) {
+    const s32 v = std::max<s32>(static_cast<s8>(value), -127);
+    return static_cast<u8>(((v + 127) * 255 + 127) / 254);
+}
+
+template <u32 BITS>
+static float UnormToFloat(u32 value) {
+    constexpr u32 MAX = (1U << BITS) - 1;
+    return static_cast<float>(value & MAX) * (1.0f / MAX);
+}
+
+template <u32 BITS>
+static float SnormToFloat(u32 value) {
+    constexpr s32 MAX = (1 << (BITS - 1)) - 1;
+    const s32 v = static_cast<s32>(value << (32 - BITS)) >> (32 - BITS);
+    return std::max(static_cast<float>(v) * (1.0f / MAX), -1.0f);
+}
+
+template <u32 BITS>
+static float SintToFloat(u32 value) {
+    return static_cast<float>(static_cast<s32>(value << (32 - BITS)) >> (32 - BITS));
+}
+
+template <u32 BITS>
+static float UintToFloat(u32 value) {
+    if constexpr (BITS < 32) value &= (1U << BITS) - 1;
+    return static_cast<float>(value);
+}
+
+/// Half-float bits to float. Scaling the shifted exponent and mantissa by 2^112 rebiases normals
+/// and denormals alike; only infinities and NaNs need their exponent set by hand.
+static float HalfToFloat(u32 half) {
+    const u32 magnitude = (half & 0x7FFF) << 13;
+    const u32 sign = (half & 0x8000) << 16;
+    float value = std::bit_cast<float>(magnitude) * 0x1p112f;
+    if (magnitude >= (0x7C00U << 13)) value = std::bit_cast<float>(magnitude | 0x7F800000);
+    return std::bit_cast<float>(std::bit_cast<u32>(value) | sign);
+}
+
+// RGBA8 targets
+
+static RGBA8 FromA8B8G8R8(u32 v) {
+    return {static_cast<u8>(v), static_cast<u8>(v >> 8), static_cast<u8>(v >> 16), static_cast<u8>(v >> 24)};
+}
+
+static RGBA8 FromA8B8G8R8Snorm(u32 v) {
+    return {SnormToByte(v), SnormToByte(v >> 8), SnormToByte(v >> 16), SnormToByte(v >> 24)};
+}
+
+static RGBA8 FromB8G8R8A8(u32 v) {
+    return {static_cast<u8>(v >> 16), static_cast<u8>(v >> 8), static_cast<u8>(v), static_cast<u8>(v >> 24)};
+}
+
+static RGBA8 FromR5G6B5(u16 v) {
+    return {UnormToByte<5>(v >> 11), UnormToByte<6>(v >> 5), UnormToByte<5>(v), 0xFF};
+}
+
+static RGBA8 FromB5G6R5(u16 v) {
+    return {UnormToByte<5>(v), UnormToByte<6>(v >> 5), UnormToByte<5>(v >> 11), 0xFF};
+}
+
+static RGBA8 FromA1R5G5B5(u16 v) {
+    return {UnormToByte<5>(v >> 10), UnormToByte<5>(v >> 5), UnormToByte<5>(v), UnormToByte<1>(v >> 15)};
+}
+
+static RGBA8 FromA1B5G5R5(u16 v) {
+    return {UnormToByte<5>(v), UnormToByte<5>(v >> 5), UnormToByte<5>(v >> 10), UnormToByte<1>(v >> 15)};
+}
+
+static RGBA8 FromA5B5G5R1(u16 v) {
+    return {UnormToByte<5>(v >> 11), UnormToByte<5>(v >> 6), UnormToByte<5>(v >> 1), UnormToByte<1>(v)};
+}
+
+static RGBA8 FromA4B4G4R4(u16 v) {
+    return {UnormToByte<4>(v), UnormToByte<4>(v >> 4), UnormToByte<4>(v >> 8), UnormToByte<4>(v >> 12)};
+}
+
+static RGBA8 FromG4R4(u8 v) {
+    return {UnormToByte<4>(v), UnormToByte<4>(v >> 4), 0, 0xFF};
+}
+
+static RGBA8 FromR8(u8 v) {
+    return {v, 0, 0, 0xFF};
+}
+
+static RGBA8 FromR8Snorm(u8 v) {
+    return {SnormToByte(v), 0, 0, 0xFF};
+}
+
+static RGBA8 FromR8G8(u16 v) {
+    return {static_cast<u8>(v), static_cast<u8>(v >> 8), 0, 0xFF};
+}
+
+static RGBA8 FromR8G8Snorm(u16 v) {
+    return {SnormToByte(v), SnormToByte(v >> 8), 0, 0xFF};
+}
+
+// RGBA32F targets
+
+template <float (*Channel)(u32)>
+static RGBA32F FromA8B8G8R8Int(u32 v) {
+    return {Channel(v), Channel(v >> 8), Channel(v >> 16), Channel(v >> 24)};
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR8Int(u8 v) {
+    return {Channel(v), 0.0f, 0.0f, 1.0f};
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR8G8Int(u16 v) {
+    return {Channel(v), Channel(v >> 8), 0.0f, 1.0f};
+}
+
+static RGBA32F FromA2B10G10R10(u32 v) {
+    return {UnormToFloat<10>(v), UnormToFloat<10>(v >> 10), UnormToFloat<10>(v >> 20), UnormToFloat<2>(v >> 30)};
+}
+
+static RGBA32F FromA2B10G10R10Uint(u32 v) {
+    return {UintToFloat<10>(v), UintToFloat<10>(v >> 10), UintToFloat<10>(v >> 20), UintToFloat<2>(v >> 30)};
+}
+
+static RGBA32F FromA2R10G10B10(u32 v) {
+    return {UnormToFloat<10>(v >> 20), UnormToFloat<10>(v >> 10), UnormToFloat<10>(v), UnormToFloat<2>(v >> 30)};
+}
+
+/// B10G11R11 packs unsigned floats with a half's exponent and a shorter mantissa, so moving the
+/// mantissa up makes them halves.
+static RGBA32F FromB10G11R11(u32 v) {
+    return {HalfToFloat((v & 0x7FF) << 4), HalfToFloat(((v >> 11) & 0x7FF) << 4),
+            HalfToFloat(((v >> 22) & 0x3FF) << 5), 1.0f};
+}
+
+/// Three 9-bit mantissas sharing a 5-bit exponent with bias 15, no implicit leading one.
+static RGBA32F FromE5B9G9R9(u32 v) {
+    const float scale = std::bit_cast<float>(((v >> 27) + 127 - 15 - 9) << 23);
+    return {static_cast<float>(v & 0x1FF) * scale, static_cast<float>((v >> 9) & 0x1FF) * scale,
+            static_cast<float>((v >> 18) & 0x1FF) * scale, 1.0f};
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR16G16B16A16(u64 v) {
+    return {Channel(static_cast<u32>(v)), Channel(static_cast<u32>(v >> 16)), Channel(static_cast<u32>(v >> 32)),
+            Channel(static_cast<u32>(v >> 48))};
+}
+
+static RGBA32F FromR16G16B16X16Float(u64 v) {
+    return {HalfToFloat(v & 0xFFFF), HalfToFloat((v >> 16) & 0xFFFF), HalfToFloat((v >> 32) & 0xFFFF), 1.0f};
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR16G16(u32 v) {
+    return {Channel(v & 0xFFFF), Channel(v >> 16), 0.0f, 1.0f};
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR16(u16 v) {
+    return {Channel(v), 0.0f, 0.0f, 1.0f};
+}
+
+static float Float32(u32 v) {
+    return std::bit_cast<float>(v);
+}
+
+static float Half(u32 v) {
+    return HalfToFloat(v & 0xFFFF);
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR32G32B32A32(U32x4 v) {
+    return {Channel(v.v[0]), Channel(v.v[1]), Channel(v.v[2]), Channel(v.v[3])};
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR32G32(u64 v) {
+    return {Channel(static_cast<u32>(v)), Channel(static_cast<u32>(v >> 32)), 0.0f, 1.0f};
+}
+
+template <float (*Channel)(u32)>
+static RGBA32F FromR32(u32 v) {
+    return {Channel(v), 0.0f, 0.0f, 1.0f};
+}
+
+const PixelDecoder* FindUncompressedDecoder(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::A8B8G8R8_UNORM:
+        case PixelFormat::A8B8G8R8_SRGB:
+            return &CONVERTER<u32, RGBA8, FromA8B8G8R8>;
+        case PixelFormat::A8B8G8R8_SNORM:
+            return &CONVERTER<u32, RGBA8, FromA8B8G8R8Snorm>;
+        case PixelFormat::A8B8G8R8_SINT:
+            return &CONVERTER<u32, RGBA32F, FromA8B8G8R8Int<SintToFloat<8>>>;
+        case PixelFormat::A8B8G8R8_UINT:
+            return &CONVERTER<u32, RGBA32F, FromA8B8G8R8Int<UintToFloat<8>>>;
+        case PixelFormat::B8G8R8A8_UNORM:
+        case PixelFormat::B8G8R8A8_SRGB:
+            return &CONVERTER<u32, RGBA8, FromB8G8R8A8>;
+        case PixelFormat::R5G6B5_UNORM:
+            return &CONVERTER<u16, RGBA8, FromR5G6B5>;
+        case PixelFormat::B5G6R5_UNORM:
+            return &CONVERTER<u16, RGBA8, FromB5G6R5>;
+        case PixelFormat::A1R5G5B5_UNORM:
+            return &CONVERTER<u16, RGBA8, FromA1R5G5B5>;
+        case PixelFormat::A1B5G5R5_UNORM:
+            return &CONVERTER<u16, RGBA8, FromA1B5G5R5>;
+        case PixelFormat::A5B5G5R1_UNORM:
+            return &CONVERTER<u16, RGBA8, FromA5B5G5R1>;
+        case PixelFormat::A4B4G4R4_UNORM:
+            return &CONVERTER<u16, RGBA8, FromA4B4G4R4>;
+        case PixelFormat::G4R4_UNORM:
+            return &CONVERTER<u8, RGBA8, FromG4R4>;
+        case PixelFormat::R8_UNORM:
+            return &CONVERTER<u8, RGBA8, FromR8>;
+        case PixelFormat::R8_SNORM:
+            return &CONVERTER<u8, RGBA8, FromR8Snorm>;
+        case PixelFormat::R8_SINT:
+            return &CONVERTER<u8, RGBA32F, FromR8Int<SintToFloat<8>>>;
+        case PixelFormat::R8_UINT:
+            return &CONVERTER<u8, RGBA32F, FromR8Int<UintToFloat<8>>>;
+        case PixelFormat::R8G8_UNORM:
+            return &CONVERTER<u16, RGBA8, FromR8G8>;
+        case PixelFormat::R8G8_SNORM:
+            return &CONVERTER<u16, RGBA8, FromR8G8Snorm>;
+        case PixelFormat::R8G8_SINT:
+            return &CONVERTER<u16, RGBA32F, FromR8G8Int<SintToFloat<8>>>;
+        case PixelFormat::R8G8_UINT:
+            return &CONVERTER<u16, RGBA32F, FromR8G8Int<UintToFloat<8>>>;
+        case PixelFormat::A2B10G10R10_UNORM:
+            return &CONVERTER<u32, RGBA32F, FromA2B10G10R10>;
+        case PixelFormat::A2B10G10R10_UINT:
+            return &CONVERTER<u32, RGBA32F, FromA2B10G10R10Uint>;
+        case PixelFormat::A2R10G10B10_UNORM:
+            return &CONVERTER<u32, RGBA32F, FromA2R10G10B10>;
+        case PixelFormat::B10G11R11_FLOAT:
+            return &CONVERTER<u32, RGBA32F, FromB10G11R11>;
+        case PixelFormat::E5B9G9R9_FLOAT:
+            return &CONVERTER<u32, RGBA32F, FromE5B9G9R9>;
+        case PixelFormat::R16G16B16A16_FLOAT:
+            return &CONVERTER<u64, RGBA32F, FromR16G16B16A16<Half>>;
+        case PixelFormat::R16G16B16X16_FLOAT:
+            return &CONVERTER<u64, RGBA32F, FromR16G16B16X16Float>;
+        case PixelFormat::R16G16B16A16_UNORM:
+            return &CONVERTER<u64, RGBA32F, FromR16G16B16A16<UnormToFloat<16>>>;
+        case PixelFormat::R16G16B16A16_SNORM:
+            return &CONVERTER<u64, RGBA32F, FromR16G16B16A16<SnormToFloat<16>>>;
+        case PixelFormat::R16G16B16A16_SINT:
+            return &CONVERTER<u64, RGBA32F, FromR16G16B16A16<SintToFloat<16>>>;
+        case PixelFormat::R16G16B16A16_UINT:
+            return &CONVERTER<u64, RGBA32F, FromR16G16B16A16<UintToFloat<16>>>;
+        case PixelFormat::R16G16_FLOAT:
+            return &CONVERTER<u32, RGBA32F, FromR16G16<Half>>;
+        case PixelFormat::R16G16_UNORM:
+            return &CONVERTER<u32, RGBA32F, FromR16G16<UnormToFloat<16>>>;
+        case PixelFormat::R16G16_SNORM:
+            return &CONVERTER<u32, RGBA32F, FromR16G16<SnormToFloat<16>>>;
+        case PixelFormat::R16G16_SINT:
+            return &CONVERTER<u32, RGBA32F, FromR16G16<SintToFloat<16>>>;
+        case PixelFormat::R16G16_UINT:
+            return &CONVERTER<u32, RGBA32F, FromR16G16<UintToFloat<16>>>;
+        case PixelFormat::R16_FLOAT:
+            return &CONVERTER<u16, RGBA32F, FromR16<Half>>;
+        case PixelFormat::R16_UNORM:
+        case PixelFormat::D16_UNORM:
+            return &CONVERTER<u16, RGBA32F, FromR16<UnormToFloat<16>>>;
+        case PixelFormat::R16_SNORM:
+            return &CONVERTER<u16, RGBA32F, FromR16<SnormToFloat<16>>>;
+        case PixelFormat::R16_SINT:
+            return &CONVERTER<u16, RGBA32F, FromR16<SintToFloat<16>>>;
+        case PixelFormat::R16_UINT:
+            return &CONVERTER<u16, RGBA32F, FromR16<UintToFloat<16>>>;
+        case PixelFormat::R32G32B32A32_FLOAT:
+            return &CONVERTER<U32x4, RGBA32F, FromR32G32B32A32<Float32>>;
+        case PixelFormat::R32G32B32A32_SINT:
+            return &CONVERTER<U32x4, RGBA32F, FromR32G32B32A32<SintToFloat<32>>>;
+        case PixelFormat::R32G32B32A32_UINT:
+            return &CONVERTER<U32x4, RGBA32F, FromR32G32B32A32<UintToFloat<32>>>;
+        case PixelFormat::R32G32_FLOAT:
+            return &CONVERTER<u64, RGBA32F, FromR32G32<Float32>>;
+        case PixelFormat::R32G32_SINT:
+            return &CONVERTER<u64, RGBA32F, FromR32G32<SintToFloat<32>>>;
+        case PixelFormat::R32G32_UINT:
+            return &CONVERTER<u64, RGBA32F, FromR32G32<UintToFloat<32>>>;
+        case PixelFormat::R32_FLOAT:
+        case PixelFormat::D32_FLOAT:
+            return &CONVERTER<u32, RGBA32F, FromR32<Float32>>;
+        case PixelFormat::R32_SINT:
+            return &CONVERTER<u32, RGBA32F, FromR32<SintToFloat<32>>>;
+        case PixelFormat::R32_UINT:
+            return &CONVERTER<u32, RGBA32F, FromR32<UintToFloat<32>>>;
+        default:
+            // R32G32B32_FLOAT's 12-byte texels have no block-linear layout here, and the
+            // depth-stencil formats pack two aspects that don't map onto colour channels.
+            return nullptr;
+    }
+}
@@ -0,0 +1,99 @@
+#include "decode.h"
+
+constexpr PixelDecoder BC1_DECODER{DecodeBC1Row, 4};
+constexpr PixelDecoder BC2_DECODER{DecodeBC2Row, 4};
+constexpr PixelDecoder BC3_DECODER{DecodeBC3Row, 4};
+constexpr PixelDecoder BC4U_DECODER{DecodeBC4URow, 4};
+constexpr PixelDecoder BC4S_DECODER{DecodeBC4SRow, 4};
+constexpr PixelDecoder BC5U_DECODER{DecodeBC5URow, 4};
+constexpr PixelDecoder BC5S_DECODER{DecodeBC5SRow, 4};
+constexpr PixelDecoder BC6HU_DECODER{DecodeBC6HURow, 8};
+constexpr PixelDecoder BC6HS_DECODER{DecodeBC6HSRow, 8};
+constexpr PixelDecoder BC7_DECODER{DecodeBC7Row, 4};
+constexpr PixelDecoder ASTC_DECODER{DecodeASTCRow, 4};
+constexpr PixelDecoder ASTC_SRGB_DECODER{DecodeASTCSrgbRow, 4};
+
+const PixelDecoder* FindPixelDecoder(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::BC1_RGBA_UNORM:
+        case PixelFormat::BC1_RGBA_SRGB:
+            return &BC1_DECODER;
+        case PixelFormat::BC2_UNORM:
+        case PixelFormat::BC2_SRGB:
+            return &BC2_DECODER;
+        case PixelFormat::BC3_UNORM:
+        case PixelFormat::BC3_SRGB:
+            return &BC3_DECODER;
+        case PixelFormat::BC4_UNORM:
+            return &BC4U_DECODER;
+        case PixelFormat::BC4_SNORM:
+            return &BC4S_DECODER;
+        case PixelFormat::BC5_UNORM:
+            return &BC5U_DECODER;
+        case PixelFormat::BC5_SNORM:
+            return &BC5S_DECODER;
+        case PixelFormat::BC6H_UFLOAT:
+            return &BC6HU_DECODER;
+        case PixelFormat::BC6H_SFLOAT:
+            return &BC6HS_DECODER;
+        case PixelFormat::BC7_UNORM:
+        case PixelFormat::BC7_SRGB:
+            return &BC7_DECODER;
+        case PixelFormat::ASTC_2D_4X4_UNORM:
+        case PixelFormat::ASTC_2D_5X4_UNORM:
+        case PixelFormat::ASTC_2D_5X5_UNORM:
+        case PixelFormat::ASTC_2D_6X5_UNORM:
+        case PixelFormat::ASTC_2D_6X6_UNORM:
+        case PixelFormat::ASTC_2D_8X5_UNORM:
+        case PixelFormat::ASTC_2D_8X6_UNORM:
+        case PixelFormat::ASTC_2D_8X8_UNORM:
+        case PixelFormat::ASTC_2D_10X5_UNORM:
+        case PixelFormat::ASTC_2D_10X6_UNORM:
+        case PixelFormat::ASTC_2D_10X8_UNORM:
+        case PixelFormat::ASTC_2D_10X10_UNORM:
+        case PixelFormat::ASTC_2D_12X12_UNORM:
+            return &ASTC_DECODER;
+        case PixelFormat::ASTC_2D_4X4_SRGB:
+        case PixelFormat::ASTC_2D_5X4_SRGB:
+        case PixelFormat::ASTC_2D_5X5_SRGB:
+        case PixelFormat::ASTC_2D_6X5_SRGB:
+        case PixelFormat::ASTC_2D_6X6_SRGB:
+        case PixelFormat::ASTC_2D_8X5_SRGB:
+        case PixelFormat::ASTC_2D_8X6_SRGB:
+        case PixelFormat::ASTC_2D_8X8_SRGB:
+        case PixelFormat::ASTC_2D_10X5_SRGB:
+        case PixelFormat::ASTC_2D_10X8_SRGB:
+        case PixelFormat::ASTC_2D_10X10_SRGB:
+        case PixelFormat::ASTC_2D_12X12_SRGB:
+            return &ASTC_SRGB_DECODER;
+        default:
+            return FindUncompressedDecoder(format);
+    }
+}
+
+void DecodeBlockRow(const PixelDecoder& decoder, const u8* blocks, u32 bytes_per_block, Extent2D block,
+                    u8* out, u32 out_pitch, u32 width, u32 rows) {
+    const u32 bpp = decoder.out_bytes_per_pixel;
+    const u32 full_blocks = width / block.width;
+
+    // Whole blocks decode in place when the row is full height.
+    u32 first_clipped = 0;
+    if (rows == block.height) {
+        decoder.decode_row(blocks, full_blocks, out, out_pitch, block);
+        first_clipped = full_blocks;
+    }
+
+    // The rest go through a one-block scratch area, of which only the visible part is copied out.
+    // ASTC footprints go up to 12x12.
+    u8 scratch[12 * 12 * 16];
+    const u32 scratch_pitch = block.width * bpp;
+    const u32 num_blocks = DivCeil(width, block.width);
+    for (u32 i = first_clipped; i < num_blocks; ++i) {
+        decoder.decode_row(blocks + i * bytes_per_block, 1, scratch, scratch_pitch, block);
+        const u32 x = i * block.width;
+        const u32 visible = std::min(block.width, width - x) * bpp;
+        for (u32 y = 0; y < rows; ++y) {
+            std::memcpy(out + y * out_pitch + x * bpp, scratch + y * scratch_pitch, visible);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "swizzle.h"
+
+/// Decodes count blocks laid side by side in one row of a linear image. Each block becomes
+/// block.width x block.height pixels; pixel rows of the output are out_pitch bytes apart.
+using DecodeRowFn = void (*)(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+
+struct PixelDecoder {
+    DecodeRowFn decode_row;
+    u32 out_bytes_per_pixel; ///< 4 for RGBA8, 8 for RGBA16F, 16 for RGBA32F
+};
+
+/// Decoder for a format, or nullptr when it has none.
+const PixelDecoder* FindPixelDecoder(PixelFormat format);
+
+/// Converter for an uncompressed format, each pixel being a 1x1 block. FindPixelDecoder falls back
+/// to this.
+const PixelDecoder* FindUncompressedDecoder(PixelFormat format);
+
+/// Decodes one row of blocks into a width x rows pixel region, clipping the blocks that hang over
+/// the right or bottom edge of the image.
+void DecodeBlockRow(const PixelDecoder& decoder, const u8* blocks, u32 bytes_per_block, Extent2D block,
+                    u8* out, u32 out_pitch, u32 width, u32 rows);
+
+void DecodeBC1Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC2Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC3Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC4URow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC4SRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC5URow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC5SRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC6HURow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC6HSRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeBC7Row(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeASTCRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
+void DecodeASTCSrgbRow(const u8* blocks, u32 count, u8* out, u32 out_pitch, Extent2D block);
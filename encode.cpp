@@ -0,0 +1,51 @@
+#include "encode.h"
+
+EncodeRowFn FindBlockEncoder(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::BC1_RGBA_UNORM:
+        case PixelFormat::BC1_RGBA_SRGB:
+            return EncodeBC1Row;
+        case PixelFormat::BC2_UNORM:
+        case PixelFormat::BC2_SRGB:
+            return EncodeBC2Row;
+        case PixelFormat::BC3_UNORM:
+        case PixelFormat::BC3_SRGB:
+            return EncodeBC3Row;
+        case PixelFormat::BC4_UNORM:
+            return EncodeBC4URow;
+        case PixelFormat::BC4_SNORM:
+            return EncodeBC4SRow;
+        case PixelFormat::BC5_UNORM:
+            return EncodeBC5URow;
+        case PixelFormat::BC5_SNORM:
+            return EncodeBC5SRow;
+        case PixelFormat::BC7_UNORM:
+        case PixelFormat::BC7_SRGB:
+            return EncodeBC7Row;
+        default:
+            return nullptr;
+    }
+}
+
+void EncodeBlockRow(EncodeRowFn encode_row, const u8* pixels, u32 pitch, u32 width, u32 rows,
+                    u8* blocks, u32 bytes_per_block, u32 quality) {
+    // Whole blocks encode straight from the image when the row is full height.
+    u32 first_clipped = 0;
+    if (rows == 4) {
+        first_clipped = width / 4;
+        encode_row(pixels, pitch, first_clipped, blocks, quality);
+    }
+
+    // The rest are gathered into a padded copy first.
+    u8 scratch[4 * 4 * 4];
+    for (u32 i = first_clipped; i < DivCeil(width, 4U); ++i) {
+        const u32 x = i * 4;
+        for (u32 y = 0; y < 4; ++y) {
+            const u8* const line = pixels + std::min(y, rows - 1) * pitch;
+            for (u32 dx = 0; dx < 4; ++dx) {
+                std::memcpy(scratch + (y * 4 + dx) * 4, line + std::min(x + dx, width - 1) * 4, 4);
+            }
+        }
+        encode_row(scratch, 16, 1, blocks + i * bytes_per_block, quality);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "swizzle.h"
+
+/// Encodes count 4x4 blocks laid side by side from the top of a linear RGBA8 image whose pixel rows
+/// are pitch bytes apart. quality (0-2) trades speed for error in formats that leave room for a
+/// search; the others ignore it.
+using EncodeRowFn = void (*)(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+
+/// Encoder for a format, or nullptr when it has none.
+EncodeRowFn FindBlockEncoder(PixelFormat format);
+
+/// Encodes a width x rows pixel region into one row of blocks. Blocks that hang over the right or
+/// bottom edge of the image are padded by repeating the last column and row.
+void EncodeBlockRow(EncodeRowFn encode_row, const u8* pixels, u32 pitch, u32 width, u32 rows,
+                    u8* blocks, u32 bytes_per_block, u32 quality);
+
+void EncodeBC1Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+void EncodeBC2Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+void EncodeBC3Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+void EncodeBC4URow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+void EncodeBC4SRow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+void EncodeBC5URow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+void EncodeBC5SRow(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
+void EncodeBC7Row(const u8* pixels, u32 pitch, u32 count, u8* blocks, u32 quality);
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "io.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define YKCMP_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// Largest single transfer handed to the OS; bigger requests go through in pieces.
+constexpr u64 IO_MAX_TRANSFER = 1U << 30;
+
+IOHandle OpenForRead(const std::filesystem::path& path, u64& size) {
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return IO_INVALID_HANDLE;
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return IO_INVALID_HANDLE;
+    }
+    size = static_cast<u64>(file_size.QuadPart);
+    return reinterpret_cast<IOHandle>(file);
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return IO_INVALID_HANDLE;
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return IO_INVALID_HANDLE;
+    }
+    size = static_cast<u64>(st.st_size);
+    return fd;
+#endif
+}
+
+IOHandle CreateForWrite(const std::filesystem::path& path) {
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                                    nullptr);
+    return file == INVALID_HANDLE_VALUE ? IO_INVALID_HANDLE : reinterpret_cast<IOHandle>(file);
+#else
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    return fd < 0 ? IO_INVALID_HANDLE : fd;
+#endif
+}
+
+void CloseFile(IOHandle file) {
+#ifdef _WIN32
+    CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+    close(static_cast<int>(file));
+#endif
+}
+
+void IOBackend::Wait() {
+    std::unique_lock lock{mutex};
+    idle.wait(lock, [&] { return outstanding == 0; });
+}
+
+void IOBackend::Started() {
+    std::scoped_lock lock{mutex};
+    ++outstanding;
+}
+
+void IOBackend::Finish(IORequest& request, bool ok) {
+    // Whatever the callback holds is released before Wait can return.
+    request.done(ok);
+    request.done = nullptr;
+    std::scoped_lock lock{mutex};
+    if (--outstanding == 0) idle.notify_all();
+}
+
+/// Blocking positional reads and writes on a pool of threads, one request per thread at a time.
+class ThreadPoolIO final : public IOBackend {
+public:
+    explicit ThreadPoolIO(u32 threads) {
+        for (u32 i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { Run(); });
+        }
+    }
+
+    ~ThreadPoolIO() override {
+        {
+            std::scoped_lock lock{mutex};
+            stopping = true;
+        }
+        ready.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    void Submit(IORequest request) override {
+        Started();
+        {
+            std::scoped_lock lock{mutex};
+            pending.push_back(std::move(request));
+        }
+        ready.notify_one();
+    }
+
+    [[nodiscard]] const char* Name() const override {
+        return "pool";
+    }
+
+private:
+    static bool Transfer(const IORequest& request) {
+        for (u64 done = 0; done < request.size;) {
+            const u64 size = std::min(request.size - done, IO_MAX_TRANSFER);
+#ifdef _WIN32
+            OVERLAPPED at{};
+            at.Offset = static_cast<DWORD>(request.offset + done);
+            at.OffsetHigh = static_cast<DWORD>((request.offset + done) >> 32);
+            DWORD moved = 0;
+            const HANDLE file = reinterpret_cast<HANDLE>(request.file);
+            const BOOL ok = request.write
+                ? WriteFile(file, request.data + done, static_cast<DWORD>(size), &moved, &at)
+                : ReadFile(file, request.data + done, static_cast<DWORD>(size), &moved, &at);
+            if (!ok || moved == 0) return false;
+#else
+            const int fd = static_cast<int>(request.file);
+            const auto offset = static_cast<off_t>(request.offset + done);
+            const ssize_t moved = request.write ? pwrite(fd, request.data + done, size, offset)
+                                                : pread(fd, request.data + done, size, offset);
+            if (moved < 0 && errno == EINTR) continue;
+            if (moved <= 0) return false;
+#endif
+            done += static_cast<u64>(moved);
+        }
+        return true;
+    }
+
+    void Run() {
+        for (;;) {
+            IORequest request;
+            {
+                std::unique_lock lock{mutex};
+                ready.wait(lock, [&] { return !pending.empty() || stopping; });
+                if (pending.empty()) return;
+                request = std::move(pending.front());
+                pending.pop_front();
+            }
+            Finish(request, Transfer(request));
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<IORequest> pending;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
+
+#ifdef YKCMP_HAS_IO_URING
+/// One ring driven by a single thread, which turns submitted requests into queue entries, enters
+/// the kernel once per batch and runs the callbacks of whatever completed. Vectored opcodes are used
+/// because they are the oldest, so any kernel with io_uring can run this.
+class IOUring final : public IOBackend {
+public:
+    /// Sets up the ring; false when the kernel has no io_uring or refuses it.
+    bool Init(u32 entries) {
+        io_uring_params params{};
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd < 0) return false;
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) sq_size = cq_size = std::max(sq_size, cq_size);
+        sq_ring = Map(sq_size, IORING_OFF_SQ_RING);
+        cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? sq_ring : Map(cq_size, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(Map(sqes_size, IORING_OFF_SQES));
+        if (!sq_ring || !cq_ring || !sqes) return false;
+
+        u8* const sq = static_cast<u8*>(sq_ring);
+        u8* const cq = static_cast<u8*>(cq_ring);
+        sq_tail = reinterpret_cast<u32*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<u32*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<u32*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<u32*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<u32*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<u32*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        depth = params.sq_entries;
+
+        thread = std::thread([this] { Run(); });
+        return true;
+    }
+
+    ~IOUring() override {
+        if (thread.joinable()) {
+            {
+                std::scoped_lock lock{mutex};
+                stopping = true;
+            }
+            ready.notify_all();
+            thread.join();
+        }
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_size);
+        if (sq_ring) munmap(sq_ring, sq_size);
+        if (ring_fd >= 0) close(ring_fd);
+    }
+
+    void Submit(IORequest request) override {
+        Started();
+        {
+            std::scoped_lock lock{mutex};
+            pending.push_back(std::make_unique<Operation>(std::move(request)));
+        }
+        ready.notify_one();
+    }
+
+    [[nodiscard]] const char* Name() const override {
+        return "io_uring";
+    }
+
+private:
+    /// A request in flight and how far it has got.
+    struct Operation {
+        explicit Operation(IORequest request_) : request(std::move(request_)) {}
+        IORequest request;
+        u64 done = 0;
+        iovec vec{};
+    };
+
+    void* Map(size_t size, u64 offset) const {
+        void* const map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                               static_cast<off_t>(offset));
+        return map == MAP_FAILED ? nullptr : map;
+    }
+
+    void Prepare(Operation* op) {
+        const u32 tail = *sq_tail;
+        const u32 index = tail & sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        sqe = {};
+        op->vec.iov_base = op->request.data + op->done;
+        op->vec.iov_len = std::min(op->request.size - op->done, IO_MAX_TRANSFER);
+        sqe.opcode = op->request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe.fd = static_cast<int>(op->request.file);
+        sqe.addr = reinterpret_cast<u64>(&op->vec);
+        sqe.len = 1;
+        sqe.off = op->request.offset + op->done;
+        sqe.user_data = reinterpret_cast<u64>(op);
+        sq_array[index] = index;
+        std::atomic_ref<u32>(*sq_tail).store(tail + 1, std::memory_order_release);
+    }
+
+    /// Runs the completions the kernel has posted. Short transfers go back on the queue for the
+    /// rest of their range.
+    void Reap(std::deque<std::unique_ptr<Operation>>& retry) {
+        u32 head = *cq_head;
+        const u32 tail = std::atomic_ref<u32>(*cq_tail).load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            std::unique_ptr<Operation> op{reinterpret_cast<Operation*>(cqe.user_data)};
+            --in_flight;
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                retry.push_back(std::move(op));
+                continue;
+            }
+            if (cqe.res <= 0) {
+                Finish(op->request, false);
+                continue;
+            }
+            op->done += static_cast<u64>(cqe.res);
+            if (op->done < op->request.size) {
+                retry.push_back(std::move(op));
+            } else {
+                Finish(op->request, true);
+            }
+        }
+        std::atomic_ref<u32>(*cq_head).store(head, std::memory_order_release);
+    }
+
+    void Run() {
+        std::deque<std::unique_ptr<Operation>> queued;
+        for (;;) {
+            {
+                std::unique_lock lock{mutex};
+                // Only sleep here when nothing is in flight; otherwise new requests wait for the next
+                // completion to come back from the kernel.
+                ready.wait(lock, [&] {
+                    return !pending.empty() || stopping || in_flight > 0 || unsubmitted > 0 || !queued.empty();
+                });
+                if (pending.empty() && stopping && in_flight == 0 && unsubmitted == 0 && queued.empty()) return;
+                for (auto& op : pending) queued.push_back(std::move(op));
+                pending.clear();
+            }
+
+            // Entries the kernel left in the submission queue last time go in again with the new ones.
+            while (!queued.empty() && in_flight + unsubmitted < depth) {
+                std::unique_ptr<Operation> op = std::move(queued.front());
+                queued.pop_front();
+                // Nothing to transfer, and a 0-byte read would come back looking like end of file.
+                if (op->request.size == 0) {
+                    Finish(op->request, true);
+                    continue;
+                }
+                Prepare(op.release());
+                ++unsubmitted;
+            }
+
+            // Only wait on requests the kernel already holds; the ones submitted now may not all be
+            // taken, and waiting on a completion that can never come would hang the ring.
+            const u32 wait_for = in_flight > 0 ? 1 : 0;
+            const long entered = syscall(__NR_io_uring_enter, ring_fd, unsubmitted, wait_for,
+                                         wait_for ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (entered < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+                // The ring is unusable; fail everything rather than hang the caller.
+                FailAll(queued);
+                return;
+            }
+            const u32 consumed = entered > 0 ? static_cast<u32>(entered) : 0;
+            unsubmitted -= consumed;
+            in_flight += consumed;
+            if (consumed == 0 && in_flight == 0) std::this_thread::yield();  // Busy, nothing to wait on
+            Reap(queued);
+        }
+    }
+
+    void FailAll(std::deque<std::unique_ptr<Operation>>& queued) {
+        std::unique_lock lock{mutex};
+        for (auto& op : pending) queued.push_back(std::move(op));
+        pending.clear();
+        lock.unlock();
+        // Entries the kernel never took are still ours; they sit just before the tail.
+        const u32 tail = *sq_tail;
+        for (u32 i = unsubmitted; i > 0; --i) {
+            std::unique_ptr<Operation> op{reinterpret_cast<Operation*>(sqes[(tail - i) & sq_mask].user_data)};
+            Finish(op->request, false);
+        }
+        unsubmitted = 0;
+        for (auto& op : queued) Finish(op->request, false);
+        queued.clear();
+    }
+
+    int ring_fd = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    size_t sq_size = 0;
+    size_t cq_size = 0;
+    size_t sqes_size = 0;
+    u32* sq_tail = nullptr;
+    u32* sq_array = nullptr;
+    u32 sq_mask = 0;
+    u32* cq_head = nullptr;
+    u32* cq_tail = nullptr;
+    u32 cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    u32 depth = 0;
+    u32 in_flight = 0;    ///< Entries the kernel has taken and not yet completed
+    u32 unsubmitted = 0;  ///< Entries prepared in the submission queue that the kernel has not taken
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::vector<std::unique_ptr<Operation>> pending;
+    std::thread thread;
+    bool stopping = false;
+};
+#endif
+
+std::unique_ptr<IOBackend> CreateIOBackend(bool prefer_io_uring, u32 queue_depth) {
+#ifdef YKCMP_HAS_IO_URING
+    if (prefer_io_uring) {
+        auto ring = std::make_unique<IOUring>();
+        if (ring->Init(queue_depth)) return ring;
+    }
+#endif
+    return std::make_unique<ThreadPoolIO>(queue_depth);
+}
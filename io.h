@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "Util.h"
+
+/// Native file handle the backends read and write: a file descriptor, or a HANDLE on Windows.
+/// IO_INVALID_HANDLE marks a failed open.
+using IOHandle = std::intptr_t;
+constexpr IOHandle IO_INVALID_HANDLE = -1;
+
+/// Opens an existing file for reading and reports its size.
+IOHandle OpenForRead(const std::filesystem::path& path, u64& size);
+/// Creates or truncates a file for writing.
+IOHandle CreateForWrite(const std::filesystem::path& path);
+void CloseFile(IOHandle file);
+
+/// One read or write of size bytes at offset. Short transfers are continued by the backend, so
+/// done only sees whether the whole range went through, or false on an error or end of file.
+struct IORequest {
+    IOHandle file;
+    u8* data;
+    u64 size;
+    u64 offset;
+    bool write;
+    /// Runs on an I/O thread once the request is over. It must not block on other requests.
+    std::function<void(bool ok)> done;
+};
+
+/// Keeps many reads and writes in flight while the caller's threads do something else.
+class IOBackend {
+public:
+    virtual ~IOBackend() = default;
+
+    virtual void Submit(IORequest request) = 0;
+    /// "io_uring" or "pool".
+    [[nodiscard]] virtual const char* Name() const = 0;
+
+    /// Blocks until every request submitted so far has completed and run its callback.
+    void Wait();
+
+protected:
+    void Started();
+    void Finish(IORequest& request, bool ok);
+
+private:
+    std::mutex mutex;
+    std::condition_variable idle;
+    u64 outstanding = 0;
+};
+
+/// io_uring when prefer_io_uring is set, the build targets Linux and the kernel allows it (it is
+/// often disabled in containers); otherwise pread/pwrite on a pool of threads. queue_depth is how
+/// many requests are in flight at once; a pool has that many threads.
+std::unique_ptr<IOBackend> CreateIOBackend(bool prefer_io_uring, u32 queue_depth);
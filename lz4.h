@@ -33,7 +33,9 @@
     - LZ4 source repository : https://github.com/lz4/lz4
 */
 
+#ifdef _WIN32
 #define LZ4_DLL_EXPORT 1
+#endif
 
 #if defined (__cplusplus)
 extern "C" {
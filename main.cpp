@@ -1,68 +1,322 @@
+// Command-line extractor: finds the YKCMP blobs in archives or directory trees and writes them out
+// decompressed, with textures optionally unswizzled, on every core.
+//
+//   utils <archive or directory> <output directory> [-j threads] [-t type=format]... [-io mode]
+//
+// Each -t maps a TEX_HDR type byte to a PixelFormat index (see SetTextureFormat); blobs holding a
+// texture of a mapped type are written unswizzled, everything else as plain decompressed data.
+// -io picks how files are read and written: "mmap" (the default) maps inputs and writes outputs
+// with plain streams, "uring" keeps many reads and writes in flight through io_uring and "pool"
+// does the same with pread/pwrite on a thread pool, which "uring" also falls back to.
 
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
-#include "Util.h"
-
-void UnswizzleImage(u8* src, u8* dst,
-    u32 width, u32 height, u32 depth, u32 mipmaps,
-    u32 bytes_per_block, u32 tile_width_spacing, u32 block_height);
-
-typedef struct {
-    uint8_t magic[8];
-    uint8_t unk_08[8];
-    uint8_t unk_10[4];
-    uint8_t type;
-    uint8_t unk_15[1];
-    uint8_t unk_16[2];
-    uint32_t width;
-    uint32_t height;
-    uint8_t unk_20[2];
-    uint8_t unk_22[2];
-    uint8_t unk_24[1];
-    uint8_t mipmaps;
-    uint8_t unk_26[1];
-    uint8_t unk_27[5];
-    uint32_t decompSize;
-    uint32_t compSize;
-    uint8_t unk_34[4];
-    uint8_t block_height;
-    uint8_t tile_spacing;
-    uint8_t unk_3A[2];
-    uint8_t unk_3C[2];
-    uint8_t unk_3E[2];
-    uint8_t pad_40[0x40];
-} TEX_HDR;
-static_assert(sizeof(TEX_HDR) == 0x80);
-
-/*
-int main() {
-    std::ifstream f("test.bin", std::ios_base::in | std::ios_base::binary);
-
-    f.seekg(0, std::ios_base::end);
-
-    const auto file_size = f.tellg();
-
-    std::vector<u8> fd(file_size, 0);
-    std::vector<u8> new_fd(file_size, 0);
-
-    f.seekg(0, std::ios_base::beg);
-
-    f.read((char*)fd.data(), file_size);
-
-    f.close();
-
-    TEX_HDR hdr{};
-    hdr.width = 512;
-    hdr.height = 512;
-    hdr.mipmaps = 1;
-    hdr.tile_spacing = 4;
-    hdr.block_height = 3;
-
-    UnswizzleImage(fd.data(), new_fd.data(),
-        hdr.height, hdr.height, 1, // depth
-        hdr.mipmaps,
-        static_cast<u32>(PixelFormat::BC1_RGBA_UNORM), hdr.tile_spacing, hdr.block_height);
-
-    return 0;
+#include "archive.h"
+#include "io.h"
+#include "parallel.h"
+#include "texture.h"
+
+namespace fs = std::filesystem;
+
+/// Blobs waiting for a worker, and decoded files waiting to be written, per worker thread.
+constexpr size_t EXTRACT_QUEUE_DEPTH = 4;
+
+/// With an I/O backend: reads and writes in flight, and the bytes that whole input files read
+/// ahead of the workers, and decoded files waiting on their write, may each hold. Inputs larger
+/// than a quarter of that are mapped instead.
+constexpr u32 EXTRACT_IO_DEPTH = 64;
+constexpr u64 EXTRACT_IO_BUDGET = 256ULL << 20;
+
+/// Caps the bytes held by one pipeline stage. A single request larger than the cap still goes
+/// through once nothing else is held.
+class ByteBudget {
+public:
+    explicit ByteBudget(u64 limit_) : limit(limit_) {}
+
+    void Acquire(u64 size) {
+        std::unique_lock lock{mutex};
+        released.wait(lock, [&] { return used == 0 || used + size <= limit; });
+        used += size;
+    }
+
+    void Release(u64 size) {
+        std::scoped_lock lock{mutex};
+        used -= size;
+        released.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    u64 limit;
+    u64 used = 0;
+};
+
+/// A blob to extract: an entry of a mapped archive, or of a file read whole into memory. With scan
+/// set it is instead a whole file whose blobs have yet to be found, and out is its relative path.
+struct ExtractJob {
+    std::shared_ptr<YKCMPArchive> archive;
+    std::shared_ptr<const std::vector<u8>> buffer;
+    YKCMPEntry entry;
+    u32 index;
+    fs::path out;
+    bool scan = false;
+};
+
+struct ExtractResult {
+    fs::path out;
+    std::vector<u8> data;
+};
+
+/// Output path of every blob in a file: the file's own relative path when the blob is the whole
+/// file, otherwise a directory of that name holding one file per blob, named by index and offset.
+static fs::path EntryPath(const fs::path& out_root, const fs::path& relative, const YKCMPEntry& entry, u32 index,
+                          u32 count, u64 file_size) {
+    if (count == 1 && entry.offset == 0 && entry.size == file_size) return out_root / relative;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%05u_%08llx.bin", index, static_cast<unsigned long long>(entry.offset));
+    return out_root / relative / name;
+}
+
+/// Decompresses one blob, unswizzling it on the way when it is a texture of a mapped type.
+static bool Extract(const ExtractJob& job, std::vector<u8>& data) {
+    const YKCMPEntry& entry = job.entry;
+    const u8* const blob = job.archive ? archive_entry_data(job.archive.get(), job.index)
+                                       : job.buffer->data() + entry.offset;
+
+    // Only blobs that start with a valid header of a mapped type are textures; anything else whose
+    // type byte happens to match would come out as garbage.
+    if (IsTexture(blob, entry.size)) {
+        const s32 texture_size = LoadTexture(blob, entry.size, nullptr, 0);
+        if (texture_size >= 0) {
+            data.resize(static_cast<u32>(texture_size));
+            const s32 status = LoadTexture(blob, entry.size, data.data(), static_cast<u32>(data.size()));
+            if (status >= 0) return true;
+            std::fprintf(stderr, "%s: texture unswizzle failed (error %d), writing it decompressed\n",
+                         job.out.string().c_str(), status);
+        }
+    }
+
+    data.resize(entry.hdr.decompSize);
+    const s32 status = job.archive ? archive_decompress(job.archive.get(), job.index, data.data(), entry.hdr.decompSize)
+                                   : decompress_safe(blob, entry.size, data.data(), entry.hdr.decompSize);
+    if (status != YKCMP_OK) {
+        std::fprintf(stderr, "%s: decompression failed (error %d)\n", job.out.string().c_str(), status);
+        return false;
+    }
+    return true;
+}
+
+static int Usage() {
+    std::fprintf(stderr, "usage: utils <archive or directory> <output directory> [-j threads] [-t type=format]... "
+                         "[-io mmap|uring|pool]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) return Usage();
+    const fs::path in_root = argv[1];
+    const fs::path out_root = argv[2];
+    u32 threads = 0;
+    std::unique_ptr<IOBackend> io;
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = static_cast<u32>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            unsigned type, fmt;
+            if (std::sscanf(argv[++i], "%u=%u", &type, &fmt) != 2 || !SetTextureFormat(type, fmt)) return Usage();
+        } else if (std::strcmp(argv[i], "-io") == 0 && i + 1 < argc) {
+            const char* const mode = argv[++i];
+            if (std::strcmp(mode, "uring") == 0 || std::strcmp(mode, "pool") == 0) {
+                io = CreateIOBackend(std::strcmp(mode, "uring") == 0, EXTRACT_IO_DEPTH);
+            } else if (std::strcmp(mode, "mmap") != 0) {
+                return Usage();
+            }
+        } else {
+            return Usage();
+        }
+    }
+    if (threads == 0) threads = DefaultThreadCount();
+
+    std::error_code error;
+    std::vector<fs::path> files;
+    if (fs::is_directory(in_root, error)) {
+        for (const auto& item : fs::recursive_directory_iterator(in_root, error)) {
+            if (item.is_regular_file()) files.push_back(item.path());
+        }
+    } else {
+        files.push_back(in_root);
+    }
+
+    // read -> decode -> write. Without a backend the reading is the mapping paging in, driven by the
+    // workers, so the main thread only indexes archives and hands out blobs and one thread writes
+    // everything. With one, whole files are read and outputs written asynchronously, and completed
+    // reads queue a scan of the file from the I/O threads, which must not block, and the scan queues
+    // its blobs; the read budget bounds that queue instead.
+    const size_t queue_depth = EXTRACT_QUEUE_DEPTH * threads;
+    BoundedQueue<ExtractJob> jobs{io ? SIZE_MAX : queue_depth};
+    BoundedQueue<ExtractResult> results{queue_depth};
+    ByteBudget read_budget{EXTRACT_IO_BUDGET};
+    ByteBudget write_budget{EXTRACT_IO_BUDGET};
+    std::atomic<u32> failed{0};
+    std::atomic<u64> bytes_in{0};
+    std::atomic<u64> bytes_out{0};
+    std::atomic<u32> written{0};
+
+    const auto queue_entries = [&](const std::vector<YKCMPEntry>& entries, const fs::path& relative, u64 file_size,
+                                   const std::shared_ptr<YKCMPArchive>& archive,
+                                   const std::shared_ptr<const std::vector<u8>>& buffer) {
+        const u32 count = static_cast<u32>(entries.size());
+        for (u32 i = 0; i < count; ++i) {
+            bytes_in.fetch_add(entries[i].size, std::memory_order_relaxed);
+            jobs.Push({archive, buffer, entries[i], i, EntryPath(out_root, relative, entries[i], i, count, file_size)});
+        }
+    };
+
+    // Whole files the backend has read go to the workers to be scanned for blobs, so a large file
+    // never holds up the I/O thread. jobs stays open until every scan has queued its entries.
+    std::mutex scan_mutex;
+    std::condition_variable scans_done;
+    u32 scans_pending = 0;
+
+    std::vector<std::thread> workers;
+    for (u32 i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            while (auto job = jobs.Pop()) {
+                if (job->scan) {
+                    const u64 file_size = job->buffer->size();
+                    queue_entries(FindYKCMPBlobs(job->buffer->data(), file_size), job->out, file_size, nullptr,
+                                  job->buffer);
+                    std::scoped_lock lock{scan_mutex};
+                    if (--scans_pending == 0) scans_done.notify_all();
+                    continue;
+                }
+                // Extract names the job's output in its messages, so the path moves over only after.
+                ExtractResult result;
+                if (Extract(*job, result.data)) {
+                    result.out = std::move(job->out);
+                    results.Push(std::move(result));
+                } else {
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    std::thread writer([&] {
+        std::error_code write_error;
+        while (auto result = results.Pop()) {
+            fs::create_directories(result->out.parent_path(), write_error);
+            if (!io) {
+                std::ofstream f(result->out, std::ios_base::out | std::ios_base::binary);
+                f.write(reinterpret_cast<const char*>(result->data.data()),
+                        static_cast<std::streamsize>(result->data.size()));
+                if (!f) {
+                    std::fprintf(stderr, "%s: write failed\n", result->out.string().c_str());
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                bytes_out.fetch_add(result->data.size(), std::memory_order_relaxed);
+                written.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            const IOHandle file = CreateForWrite(result->out);
+            if (file == IO_INVALID_HANDLE) {
+                std::fprintf(stderr, "%s: cannot create\n", result->out.string().c_str());
+                failed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            const u64 size = result->data.size();
+            if (size == 0) {
+                CloseFile(file);
+                written.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            write_budget.Acquire(size);
+            auto data = std::make_shared<ExtractResult>(std::move(*result));
+            io->Submit({file, data->data.data(), size, 0, true, [&, file, data, size](bool ok) {
+                CloseFile(file);
+                if (ok) {
+                    bytes_out.fetch_add(size, std::memory_order_relaxed);
+                    written.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::fprintf(stderr, "%s: write failed\n", data->out.string().c_str());
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                }
+                write_budget.Release(size);
+            }});
+        }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const fs::path& file : files) {
+        const fs::path relative = file == in_root ? file.filename() : fs::relative(file, in_root);
+
+        u64 file_size = 0;
+        const IOHandle handle = io ? OpenForRead(file, file_size) : IO_INVALID_HANDLE;
+        if (handle != IO_INVALID_HANDLE && file_size > EXTRACT_IO_BUDGET / 4) {
+            CloseFile(handle);
+        } else if (handle != IO_INVALID_HANDLE) {
+            // The buffer returns its bytes to the budget once the last blob in it is decoded.
+            read_budget.Acquire(file_size);
+            std::shared_ptr<std::vector<u8>> buffer{new std::vector<u8>(file_size), [&, file_size](std::vector<u8>* p) {
+                delete p;
+                read_budget.Release(file_size);
+            }};
+            io->Submit({handle, buffer->data(), file_size, 0, false, [&, handle, buffer, relative, file](bool ok) {
+                CloseFile(handle);
+                if (!ok) {
+                    std::fprintf(stderr, "%s: read failed\n", file.string().c_str());
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                {
+                    std::scoped_lock lock{scan_mutex};
+                    ++scans_pending;
+                }
+                jobs.Push({nullptr, buffer, {}, 0, relative, true});
+            }});
+            continue;
+        }
+
+        std::shared_ptr<YKCMPArchive> archive{archive_open(file.string().c_str()), archive_close};
+        if (!archive) {
+            std::fprintf(stderr, "%s: cannot open\n", file.string().c_str());
+            failed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        file_size = fs::file_size(file, error);
+        std::vector<YKCMPEntry> entries(archive_entry_count(archive.get()));
+        for (u32 i = 0; i < entries.size(); ++i) archive_entry(archive.get(), i, &entries[i]);
+        queue_entries(entries, relative, file_size, archive, nullptr);
+    }
+    // Every read has queued its scan once the backend is idle, even if writes start again later, and
+    // every blob is queued once the scans are done.
+    if (io) {
+        io->Wait();
+        std::unique_lock lock{scan_mutex};
+        scans_done.wait(lock, [&] { return scans_pending == 0; });
+    }
+    jobs.Close();
+    for (auto& worker : workers) worker.join();
+    results.Close();
+    writer.join();
+    if (io) io->Wait();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double mb_in = static_cast<double>(bytes_in.load()) / 1e6;
+    const double mb_out = static_cast<double>(bytes_out.load()) / 1e6;
+    std::printf("%u files from %zu inputs, %.1f MB -> %.1f MB in %.2f s (%.1f MB/s in, %.1f MB/s out), %u failed, "
+                "I/O: %s\n", written.load(), files.size(), mb_in, mb_out, seconds, mb_in / seconds, mb_out / seconds,
+                failed.load(), io ? io->Name() : "mmap");
+    io.reset();
+    return failed.load() == 0 ? 0 : 1;
 }
-*/
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "Util.h"
+
+/// Worker count used when a caller passes 0 threads: one per hardware thread.
+[[nodiscard]] inline u32 DefaultThreadCount() {
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+/// Runs fn(i) for every i in [0, count) on up to num_threads threads (0 means DefaultThreadCount),
+/// the calling thread included. Workers claim the next index from a shared counter as soon as they
+/// finish one, so uneven items balance out; order the indices largest first for the best results.
+template <typename Fn>
+void ParallelFor(u32 count, u32 num_threads, Fn&& fn) {
+    if (num_threads == 0) num_threads = DefaultThreadCount();
+    num_threads = std::min(num_threads, count);
+
+    if (num_threads <= 1) {
+        for (u32 i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<u32> next{0};
+    const auto work = [&] {
+        for (u32 i = next.fetch_add(1, std::memory_order_relaxed); i < count;
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads - 1);
+    for (u32 i = 1; i < num_threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/// Queue between two pipeline stages. Push blocks while capacity items are waiting, which bounds
+/// the memory held between stages; Pop blocks until an item arrives or the producers Close it.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity_) : capacity(capacity_) {}
+
+    void Push(T item) {
+        std::unique_lock lock{mutex};
+        not_full.wait(lock, [&] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+    }
+
+    /// Next item, or nothing once the queue is closed and drained.
+    std::optional<T> Pop() {
+        std::unique_lock lock{mutex};
+        not_empty.wait(lock, [&] { return !items.empty() || closed; });
+        if (items.empty()) return std::nullopt;
+        T item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return item;
+    }
+
+    void Close() {
+        std::scoped_lock lock{mutex};
+        closed = true;
+        not_empty.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+};
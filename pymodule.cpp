@@ -0,0 +1,373 @@
+// CPython extension exposing the same entry points as the DLL. Buffers come in through the buffer
+// protocol and the GIL is released while decoding or swizzling, so Python threads scale.
+// Built by setup.py rather than the Visual Studio project.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <limits>
+#include "archive.h"
+#include "encode.h"
+#include "swizzle.h"
+#include "texture.h"
+#include "ykcmp.h"
+
+/// Owns a Py_buffer for the duration of a call.
+class PyBufferView {
+public:
+    PyBufferView() = default;
+    PyBufferView(const PyBufferView&) = delete;
+    PyBufferView& operator=(const PyBufferView&) = delete;
+    ~PyBufferView() {
+        if (acquired) PyBuffer_Release(&view);
+    }
+
+    bool Acquire(PyObject* obj, int flags) {
+        acquired = PyObject_GetBuffer(obj, &view, flags | PyBUF_C_CONTIGUOUS) == 0;
+        return acquired;
+    }
+
+    [[nodiscard]] u8* Data() const {
+        return static_cast<u8*>(view.buf);
+    }
+
+    [[nodiscard]] Py_ssize_t Size() const {
+        return view.len;
+    }
+
+private:
+    Py_buffer view{};
+    bool acquired = false;
+};
+
+/// Acquires a read-only view of data no larger than the 32-bit sizes the library takes.
+static bool AcquireInput(PyObject* data, PyBufferView& view) {
+    if (!view.Acquire(data, PyBUF_SIMPLE)) return false;
+    if (view.Size() > std::numeric_limits<u32>::max()) {
+        PyErr_SetString(PyExc_OverflowError, "input buffer is larger than 4 GiB");
+        return false;
+    }
+    return true;
+}
+
+/// Returns a new reference to the output object: out itself if the caller passed a writable
+/// buffer of at least size bytes, otherwise a fresh bytearray.
+static PyObject* AcquireOutput(PyObject* out, Py_ssize_t size, PyBufferView& view) {
+    PyObject* result = out;
+    if (out == Py_None) {
+        result = PyByteArray_FromStringAndSize(nullptr, size);
+        if (!result) return nullptr;
+    } else {
+        Py_INCREF(result);
+    }
+
+    if (!view.Acquire(result, PyBUF_WRITABLE)) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    if (view.Size() < size) {
+        PyErr_Format(PyExc_ValueError, "output buffer holds %zd bytes, %zd needed", view.Size(), size);
+        Py_DECREF(result);
+        return nullptr;
+    }
+    return result;
+}
+
+static PyObject* Decompress(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"data", "out", nullptr};
+    PyObject* data;
+    PyObject* out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O:decompress", const_cast<char**>(keywords),
+                                     &data, &out)) {
+        return nullptr;
+    }
+
+    PyBufferView in;
+    if (!AcquireInput(data, in)) return nullptr;
+    if (in.Size() < static_cast<Py_ssize_t>(sizeof(YKCMP_HDR))) {
+        PyErr_SetString(PyExc_ValueError, "input is smaller than a YKCMP header");
+        return nullptr;
+    }
+    YKCMP_HDR hdr{};
+    memcpy(&hdr, in.Data(), sizeof(YKCMP_HDR));
+
+    PyBufferView dst;
+    PyObject* result = AcquireOutput(out, hdr.decompSize, dst);
+    if (!result) return nullptr;
+
+    s32 status;
+    Py_BEGIN_ALLOW_THREADS
+    status = decompress_safe(in.Data(), static_cast<u32>(in.Size()), dst.Data(), hdr.decompSize);
+    Py_END_ALLOW_THREADS
+
+    if (status != YKCMP_OK) {
+        Py_DECREF(result);
+        PyErr_Format(PyExc_ValueError, "YKCMP decompression failed (error %d)", status);
+        return nullptr;
+    }
+    return result;
+}
+
+static PyObject* Scan(PyObject*, PyObject* args) {
+    PyObject* data;
+    if (!PyArg_ParseTuple(args, "O:scan", &data)) return nullptr;
+
+    PyBufferView in;
+    if (!in.Acquire(data, PyBUF_SIMPLE)) return nullptr;
+    std::vector<YKCMPEntry> entries;
+    Py_BEGIN_ALLOW_THREADS
+    entries = FindYKCMPBlobs(in.Data(), static_cast<u64>(in.Size()));
+    Py_END_ALLOW_THREADS
+
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(entries.size()));
+    if (!result) return nullptr;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const YKCMPEntry& entry = entries[i];
+        PyObject* item = Py_BuildValue("(KIII)", static_cast<unsigned long long>(entry.offset), entry.size,
+                                       entry.hdr.compType, entry.hdr.decompSize);
+        if (!item) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), item);
+    }
+    return result;
+}
+
+template <bool TO_LINEAR>
+static PyObject* SwizzleCall(PyObject* args, PyObject* kwargs, const char* format) {
+    static const char* keywords[] = {"data", "width", "height", "depth", "mipmaps", "format",
+                                     "tile_spacing", "block_height", "out", "layers", "threads", nullptr};
+    PyObject* data;
+    PyObject* out = Py_None;
+    unsigned int width, height, depth, mipmaps, fmt, tile_spacing, block_height;
+    unsigned int layers = 1;
+    unsigned int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, const_cast<char**>(keywords), &data,
+                                     &width, &height, &depth, &mipmaps, &fmt, &tile_spacing,
+                                     &block_height, &out, &layers, &threads)) {
+        return nullptr;
+    }
+    if (!IsValidImageShape(width, height, depth, mipmaps, layers, fmt, tile_spacing, block_height)) {
+        PyErr_SetString(PyExc_ValueError, "invalid or oversized texture shape");
+        return nullptr;
+    }
+
+    const u32 linear_size = UnswizzledArraySize(width, height, depth, mipmaps, layers, fmt);
+    const u32 swizzled_size = SwizzledArraySize(width, height, depth, mipmaps, layers, fmt, tile_spacing,
+                                                block_height);
+    const u32 in_size = TO_LINEAR ? swizzled_size : linear_size;
+    const u32 out_size = TO_LINEAR ? linear_size : swizzled_size;
+
+    PyBufferView in;
+    if (!AcquireInput(data, in)) return nullptr;
+    if (in.Size() < in_size) {
+        PyErr_Format(PyExc_ValueError, "input holds %zd bytes, %u needed", in.Size(), in_size);
+        return nullptr;
+    }
+
+    PyBufferView dst;
+    PyObject* result = AcquireOutput(out, out_size, dst);
+    if (!result) return nullptr;
+
+    Py_BEGIN_ALLOW_THREADS
+    if constexpr (TO_LINEAR) {
+        UnswizzleImageArray(in.Data(), dst.Data(), width, height, depth, mipmaps, layers, fmt, tile_spacing,
+                            block_height, threads);
+    } else {
+        SwizzleImageArray(in.Data(), dst.Data(), width, height, depth, mipmaps, layers, fmt, tile_spacing,
+                          block_height, threads);
+    }
+    Py_END_ALLOW_THREADS
+
+    return result;
+}
+
+static PyObject* Decode(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"data", "width", "height", "depth", "mipmaps", "format",
+                                     "tile_spacing", "block_height", "out", "layers", "threads", nullptr};
+    PyObject* data;
+    PyObject* out = Py_None;
+    unsigned int width, height, depth, mipmaps, fmt, tile_spacing, block_height;
+    unsigned int layers = 1;
+    unsigned int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OIIIIIII|OII:decode", const_cast<char**>(keywords), &data,
+                                     &width, &height, &depth, &mipmaps, &fmt, &tile_spacing,
+                                     &block_height, &out, &layers, &threads)) {
+        return nullptr;
+    }
+    if (!IsValidImageShape(width, height, depth, mipmaps, layers, fmt, tile_spacing, block_height)) {
+        PyErr_SetString(PyExc_ValueError, "invalid or oversized texture shape");
+        return nullptr;
+    }
+    const u32 decoded_size = DecodedImageSize(width, height, depth, mipmaps, layers, fmt);
+    if (decoded_size == 0) {
+        PyErr_Format(PyExc_ValueError, "no decoder for format %u", fmt);
+        return nullptr;
+    }
+
+    const u32 in_size = SwizzledArraySize(width, height, depth, mipmaps, layers, fmt, tile_spacing, block_height);
+    PyBufferView in;
+    if (!AcquireInput(data, in)) return nullptr;
+    if (in.Size() < in_size) {
+        PyErr_Format(PyExc_ValueError, "input holds %zd bytes, %u needed", in.Size(), in_size);
+        return nullptr;
+    }
+
+    PyBufferView dst;
+    PyObject* result = AcquireOutput(out, decoded_size, dst);
+    if (!result) return nullptr;
+
+    Py_BEGIN_ALLOW_THREADS
+    DecodeImage(in.Data(), dst.Data(), width, height, depth, mipmaps, layers, fmt, tile_spacing,
+                block_height, threads);
+    Py_END_ALLOW_THREADS
+
+    return result;
+}
+
+static PyObject* Encode(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"data", "width", "height", "depth", "mipmaps", "format", "tile_spacing",
+                                     "block_height", "out", "layers", "quality", "threads", nullptr};
+    PyObject* data;
+    PyObject* out = Py_None;
+    unsigned int width, height, depth, mipmaps, fmt, tile_spacing, block_height;
+    unsigned int layers = 1;
+    unsigned int quality = 1;
+    unsigned int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OIIIIIII|OIII:encode", const_cast<char**>(keywords), &data,
+                                     &width, &height, &depth, &mipmaps, &fmt, &tile_spacing,
+                                     &block_height, &out, &layers, &quality, &threads)) {
+        return nullptr;
+    }
+    if (!IsValidImageShape(width, height, depth, mipmaps, layers, fmt, tile_spacing, block_height)) {
+        PyErr_SetString(PyExc_ValueError, "invalid or oversized texture shape");
+        return nullptr;
+    }
+    if (!FindBlockEncoder(static_cast<PixelFormat>(fmt))) {
+        PyErr_Format(PyExc_ValueError, "no encoder for format %u", fmt);
+        return nullptr;
+    }
+
+    // Every encodable format decodes to RGBA8, so its decoded size is the input's.
+    const u32 in_size = DecodedImageSize(width, height, depth, mipmaps, layers, fmt);
+    PyBufferView in;
+    if (!AcquireInput(data, in)) return nullptr;
+    if (in.Size() < in_size) {
+        PyErr_Format(PyExc_ValueError, "input holds %zd bytes, %u needed", in.Size(), in_size);
+        return nullptr;
+    }
+
+    const u32 out_size = SwizzledArraySize(width, height, depth, mipmaps, layers, fmt, tile_spacing, block_height);
+    PyBufferView dst;
+    PyObject* result = AcquireOutput(out, out_size, dst);
+    if (!result) return nullptr;
+
+    Py_BEGIN_ALLOW_THREADS
+    EncodeImage(in.Data(), dst.Data(), width, height, depth, mipmaps, layers, fmt, tile_spacing,
+                block_height, quality, threads);
+    Py_END_ALLOW_THREADS
+
+    return result;
+}
+
+static PyObject* SetTextureFormatCall(PyObject*, PyObject* args) {
+    unsigned int type, fmt;
+    if (!PyArg_ParseTuple(args, "II:set_texture_format", &type, &fmt)) return nullptr;
+    if (!SetTextureFormat(type, fmt)) {
+        PyErr_SetString(PyExc_ValueError, "type must be below 256 and format a PixelFormat index");
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* LoadTextureCall(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"data", "out", nullptr};
+    PyObject* data;
+    PyObject* out = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O:load_texture", const_cast<char**>(keywords), &data,
+                                     &out)) {
+        return nullptr;
+    }
+
+    PyBufferView in;
+    if (!AcquireInput(data, in)) return nullptr;
+    const u32 in_size = static_cast<u32>(in.Size());
+
+    s32 status;
+    Py_BEGIN_ALLOW_THREADS
+    status = LoadTexture(in.Data(), in_size, nullptr, 0);
+    Py_END_ALLOW_THREADS
+    if (status < 0) {
+        PyErr_Format(PyExc_ValueError, "texture header rejected (error %d)", status);
+        return nullptr;
+    }
+
+    const u32 size = static_cast<u32>(status);
+    PyBufferView dst;
+    PyObject* result = AcquireOutput(out, size, dst);
+    if (!result) return nullptr;
+
+    Py_BEGIN_ALLOW_THREADS
+    status = LoadTexture(in.Data(), in_size, dst.Data(), size);
+    Py_END_ALLOW_THREADS
+
+    if (status < 0) {
+        Py_DECREF(result);
+        PyErr_Format(PyExc_ValueError, "texture load failed (error %d)", status);
+        return nullptr;
+    }
+    return result;
+}
+
+static PyObject* Unswizzle(PyObject*, PyObject* args, PyObject* kwargs) {
+    return SwizzleCall<true>(args, kwargs, "OIIIIIII|OII:unswizzle");
+}
+
+static PyObject* Swizzle(PyObject*, PyObject* args, PyObject* kwargs) {
+    return SwizzleCall<false>(args, kwargs, "OIIIIIII|OII:swizzle");
+}
+
+static PyMethodDef METHODS[] = {
+    {"decompress", reinterpret_cast<PyCFunction>(Decompress), METH_VARARGS | METH_KEYWORDS,
+     "decompress(data, out=None)\n--\n\n"
+     "Decompresses a YKCMP blob into out, or a new bytearray of the header's decompSize."},
+    {"scan", reinterpret_cast<PyCFunction>(Scan), METH_VARARGS,
+     "scan(data)\n--\n\n"
+     "Lists the YKCMP blobs in a buffer, e.g. an mmap of an archive, as (offset, size, type, decompSize)\n"
+     "tuples. Slicing a memoryview of the buffer at those offsets feeds decompress without a copy."},
+    {"unswizzle", reinterpret_cast<PyCFunction>(Unswizzle), METH_VARARGS | METH_KEYWORDS,
+     "unswizzle(data, width, height, depth, mipmaps, format, tile_spacing, block_height, out=None, layers=1, threads=1)\n--\n\n"
+     "Converts a block-linear texture to linear layout. format is a PixelFormat index and threads=0\n"
+     "uses one thread per core."},
+    {"swizzle", reinterpret_cast<PyCFunction>(Swizzle), METH_VARARGS | METH_KEYWORDS,
+     "swizzle(data, width, height, depth, mipmaps, format, tile_spacing, block_height, out=None, layers=1, threads=1)\n--\n\n"
+     "Converts a linear texture to block-linear layout. format is a PixelFormat index and threads=0\n"
+     "uses one thread per core."},
+    {"decode", reinterpret_cast<PyCFunction>(Decode), METH_VARARGS | METH_KEYWORDS,
+     "decode(data, width, height, depth, mipmaps, format, tile_spacing, block_height, out=None, layers=1, threads=1)\n--\n\n"
+     "Unswizzles and decodes a block-linear texture to RGBA8 (RGBA16F for BC6H, RGBA32F for wide formats) in one pass."},
+    {"encode", reinterpret_cast<PyCFunction>(Encode), METH_VARARGS | METH_KEYWORDS,
+     "encode(data, width, height, depth, mipmaps, format, tile_spacing, block_height, out=None, layers=1, quality=1, threads=1)\n--\n\n"
+     "Encodes RGBA8 pixels to a block-linear BC1-BC5 or BC7 texture. quality runs from 0 (fastest)\n"
+     "to 2 (smallest error)."},
+    {"set_texture_format", reinterpret_cast<PyCFunction>(SetTextureFormatCall), METH_VARARGS,
+     "set_texture_format(type, format)\n--\n\n"
+     "Maps a texture header's type byte to a PixelFormat index for load_texture."},
+    {"load_texture", reinterpret_cast<PyCFunction>(LoadTextureCall), METH_VARARGS | METH_KEYWORDS,
+     "load_texture(data, out=None)\n--\n\n"
+     "Parses a texture file, decompresses it if needed and unswizzles every mip level in one call."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+static PyModuleDef MODULE = {
+    PyModuleDef_HEAD_INIT,
+    "ykcmp",
+    "YKCMP decompression and texture swizzling for Disgaea assets.",
+    -1,
+    METHODS,
+};
+
+PyMODINIT_FUNC PyInit_ykcmp() {
+    return PyModule_Create(&MODULE);
+}
@@ -0,0 +1,21 @@
+import sys
+
+from setuptools import Extension, setup
+
+if sys.platform == "win32":
+    compile_args = ["/std:c++latest", "/O2"]
+else:
+    compile_args = ["-std=c++20", "-O3"]
+
+setup(
+    name="ykcmp",
+    version="1.0.0",
+    description="YKCMP decompression and texture swizzling for Disgaea assets",
+    ext_modules=[
+        Extension(
+            "ykcmp",
+            sources=["pymodule.cpp", "Util.cpp", "swizzle.cpp", "swizzle_simd.cpp", "decode.cpp", "bcn.cpp", "astc.cpp", "convert.cpp", "encode.cpp", "bcn_encode.cpp", "texture.cpp", "stream.cpp", "archive.cpp", "lz4.c"],
+            extra_compile_args=compile_args,
+        )
+    ],
+)
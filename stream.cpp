@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "ykcmp.h"
+
+// Type 4 offsets are a 12-bit field plus one, so 4 KiB of history is all a back-reference can
+// reach. The ring is twice that so a full window of undrained output can sit beside the history.
+constexpr u32 TYPE4_RING_SIZE = TYPE4_WINDOW_SIZE * 2;
+
+// Types 8/9 wrap a single LZ4 block, whose offsets are 16-bit.
+constexpr u32 LZ4_WINDOW_SIZE = 0x10000;
+constexpr u32 LZ4_RING_SIZE = LZ4_WINDOW_SIZE * 2;
+
+/// Where an LZ4 sequence (token, literal length, literals, offset, match length, match) was
+/// interrupted by the end of the input or a full ring.
+enum class LZ4Phase : u8 {
+    Token,
+    LiteralLength,
+    Literals,
+    Offset,
+    MatchLength,
+    Match,
+};
+
+struct YKCMPStream {
+    YKCMP_HDR hdr{};
+    u32 hdr_filled = 0;
+    s32 status = YKCMP_OK;
+
+    std::vector<u8> ring;
+    u32 ring_mask = 0;
+    u64 produced = 0; ///< Bytes decoded into the ring so far
+    u64 drained = 0;  ///< Bytes handed back to the caller so far
+
+    // A token can be split across feed calls, so its control and extra bytes are collected here
+    // and a literal run or match that doesn't fit in the ring is resumed on the next call.
+    u8 token[3]{};
+    u32 token_filled = 0;
+    u32 literal_left = 0;
+    u32 match_left = 0;
+    u32 match_offset = 0;
+    LZ4Phase lz4_phase = LZ4Phase::Token;
+
+    s32 Fail(s32 error) {
+        status = error;
+        return error;
+    }
+
+    /// Space left before the ring would overwrite undrained output.
+    [[nodiscard]] u32 Room() const {
+        return static_cast<u32>(ring.size() - (produced - drained));
+    }
+
+    s32 Start() {
+        if (memcmp(hdr.magic, YKCMP_MAGIC, sizeof(YKCMP_MAGIC)) != 0) return Fail(YKCMP_ERROR_HEADER);
+
+        switch (hdr.compType) {
+            case 4:
+                ring.resize(TYPE4_RING_SIZE);
+                break;
+            case 8:
+            case 9:
+                ring.resize(LZ4_RING_SIZE);
+                break;
+            default:
+                return Fail(YKCMP_ERROR_TYPE);
+        }
+        ring_mask = static_cast<u32>(ring.size() - 1);
+        return YKCMP_OK;
+    }
+
+    void WriteLiteral(const u8* src, u32 size) {
+        const u32 pos = static_cast<u32>(produced) & ring_mask;
+        const u32 first = std::min<u32>(size, static_cast<u32>(ring.size()) - pos);
+        memcpy(&ring[pos], src, first);
+        memcpy(&ring[0], src + first, size - first);
+        produced += size;
+    }
+
+    void WriteMatch(u32 offset, u32 size) {
+        if (offset == 1) {
+            const u8 value = ring[(produced - 1) & ring_mask];
+            while (size > 0) {
+                const u32 pos = static_cast<u32>(produced) & ring_mask;
+                const u32 chunk = std::min<u32>(size, static_cast<u32>(ring.size()) - pos);
+                memset(&ring[pos], value, chunk);
+                produced += chunk;
+                size -= chunk;
+            }
+            return;
+        }
+
+        // Copy in pieces no longer than the offset so source and destination never overlap, and
+        // split them wherever either side wraps around the ring.
+        while (size > 0) {
+            const u32 dst = static_cast<u32>(produced) & ring_mask;
+            const u32 src = static_cast<u32>(produced - offset) & ring_mask;
+            const u32 chunk = std::min({size, offset, static_cast<u32>(ring.size()) - dst,
+                                        static_cast<u32>(ring.size()) - src});
+            memcpy(&ring[dst], &ring[src], chunk);
+            produced += chunk;
+            size -= chunk;
+        }
+    }
+
+    s32 FeedType4(const u8* in, u32 in_size, u32 inPos) {
+        while (produced < hdr.decompSize) {
+            if (literal_left > 0) {
+                const u32 size = std::min({literal_left, in_size - inPos, Room()});
+                if (size == 0) break;
+                WriteLiteral(&in[inPos], size);
+                inPos += size;
+                literal_left -= size;
+                continue;
+            }
+            if (match_left > 0) {
+                const u32 size = std::min(match_left, Room());
+                if (size == 0) break;
+                WriteMatch(match_offset, size);
+                match_left -= size;
+                continue;
+            }
+
+            if (inPos == in_size) break;
+            if (token_filled == 0) token[token_filled++] = in[inPos++];
+            const u32 token_size = 1 + Type4ExtraBytes(token[0]);
+            while (token_filled < token_size && inPos < in_size) token[token_filled++] = in[inPos++];
+            if (token_filled < token_size) break;
+            token_filled = 0;
+
+            if (token[0] < 0x80) {
+                literal_left = token[0];
+            } else {
+                size_t tokenPos = 1;
+                DecodeType4Match(token[0], token, tokenPos, match_offset, match_left);
+                if (match_offset > produced) return Fail(YKCMP_ERROR_OFFSET);
+            }
+            if (literal_left + match_left > hdr.decompSize - produced) return Fail(YKCMP_ERROR_OUTPUT_OVERRUN);
+        }
+
+        // Anything after the last token is padding.
+        if (produced == hdr.decompSize) inPos = in_size;
+        return static_cast<s32>(inPos);
+    }
+
+    // YKCMP's LZ4 payload is one block, and LZ4_decompress_safe_continue can only resume between
+    // blocks, so sequences are decoded here directly against the ring.
+    s32 FeedLZ4(const u8* in, u32 in_size, u32 inPos) {
+        while (produced < hdr.decompSize) {
+            switch (lz4_phase) {
+                case LZ4Phase::Token:
+                    if (inPos == in_size) return static_cast<s32>(inPos);
+                    token[0] = in[inPos++];
+                    literal_left = token[0] >> 4;
+                    lz4_phase = literal_left == 15 ? LZ4Phase::LiteralLength : LZ4Phase::Literals;
+                    break;
+
+                case LZ4Phase::LiteralLength:
+                {
+                    if (inPos == in_size) return static_cast<s32>(inPos);
+                    const u8 length = in[inPos++];
+                    // Checked per byte, so a long run of 255s fails here instead of wrapping the count.
+                    if (u64{literal_left} + length > hdr.decompSize - produced) {
+                        return Fail(YKCMP_ERROR_OUTPUT_OVERRUN);
+                    }
+                    literal_left += length;
+                    if (length != 255) lz4_phase = LZ4Phase::Literals;
+                    break;
+                }
+
+                case LZ4Phase::Literals:
+                {
+                    if (literal_left > hdr.decompSize - produced) return Fail(YKCMP_ERROR_OUTPUT_OVERRUN);
+                    const u32 size = std::min({literal_left, in_size - inPos, Room()});
+                    WriteLiteral(&in[inPos], size);
+                    inPos += size;
+                    literal_left -= size;
+                    if (literal_left > 0) return static_cast<s32>(inPos);
+                    // The last sequence of a block has no match part.
+                    lz4_phase = LZ4Phase::Offset;
+                    token_filled = 1;
+                    break;
+                }
+
+                case LZ4Phase::Offset:
+                    while (token_filled < 3 && inPos < in_size) token[token_filled++] = in[inPos++];
+                    if (token_filled < 3) return static_cast<s32>(inPos);
+                    token_filled = 0;
+                    match_offset = token[1] | (token[2] << 8);
+                    if (match_offset == 0 || match_offset > produced) return Fail(YKCMP_ERROR_OFFSET);
+                    match_left = (token[0] & 0xF) + 4;
+                    lz4_phase = (token[0] & 0xF) == 15 ? LZ4Phase::MatchLength : LZ4Phase::Match;
+                    break;
+
+                case LZ4Phase::MatchLength:
+                {
+                    if (inPos == in_size) return static_cast<s32>(inPos);
+                    const u8 length = in[inPos++];
+                    if (u64{match_left} + length > hdr.decompSize - produced) {
+                        return Fail(YKCMP_ERROR_OUTPUT_OVERRUN);
+                    }
+                    match_left += length;
+                    if (length != 255) lz4_phase = LZ4Phase::Match;
+                    break;
+                }
+
+                case LZ4Phase::Match:
+                {
+                    if (match_left > hdr.decompSize - produced) return Fail(YKCMP_ERROR_OUTPUT_OVERRUN);
+                    const u32 size = std::min(match_left, Room());
+                    WriteMatch(match_offset, size);
+                    match_left -= size;
+                    if (match_left > 0) return static_cast<s32>(inPos);
+                    lz4_phase = LZ4Phase::Token;
+                    break;
+                }
+            }
+        }
+
+        if (produced == hdr.decompSize) inPos = in_size;
+        return static_cast<s32>(inPos);
+    }
+
+    s32 Feed(const u8* in, u32 in_size) {
+        if (status < 0) return status;
+
+        u32 inPos = 0;
+        if (hdr_filled < sizeof(YKCMP_HDR)) {
+            const u32 size = std::min<u32>(in_size, sizeof(YKCMP_HDR) - hdr_filled);
+            memcpy(reinterpret_cast<u8*>(&hdr) + hdr_filled, in, size);
+            hdr_filled += size;
+            inPos += size;
+            if (hdr_filled < sizeof(YKCMP_HDR)) return static_cast<s32>(inPos);
+            if (Start() < 0) return status;
+        }
+
+        return hdr.compType == 4 ? FeedType4(in, in_size, inPos) : FeedLZ4(in, in_size, inPos);
+    }
+
+    u32 Drain(u8* out, u32 out_size) {
+        const u32 size = static_cast<u32>(std::min<u64>(out_size, produced - drained));
+        const u32 pos = static_cast<u32>(drained) & ring_mask;
+        const u32 first = std::min<u32>(size, static_cast<u32>(ring.size()) - pos);
+        memcpy(out, &ring[pos], first);
+        memcpy(out + first, &ring[0], size - first);
+        drained += size;
+        return size;
+    }
+};
+
+extern "C" YKCMP_API
+YKCMPStream* decompress_stream_init() {
+    return new YKCMPStream();
+}
+
+extern "C" YKCMP_API
+s32 decompress_stream_feed(YKCMPStream* stream, const u8* in, u32 in_size) {
+    return stream->Feed(in, in_size);
+}
+
+extern "C" YKCMP_API
+u32 decompress_stream_drain(YKCMPStream* stream, u8* out, u32 out_size) {
+    if (stream->ring.empty()) return 0;
+    return stream->Drain(out, out_size);
+}
+
+extern "C" YKCMP_API
+s32 decompress_stream_finish(YKCMPStream* stream) {
+    s32 status = stream->status;
+    if (status == YKCMP_OK) {
+        if (stream->hdr_filled < sizeof(YKCMP_HDR)) {
+            status = YKCMP_ERROR_HEADER;
+        } else if (stream->drained != stream->hdr.decompSize) {
+            status = YKCMP_ERROR_TRUNCATED;
+        }
+    }
+    delete stream;
+    return status;
+}
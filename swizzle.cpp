@@ -1,21 +1,56 @@
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "decode.h"
+#include "encode.h"
+#include "parallel.h"
 #include "swizzle.h"
+#include "swizzle_simd.h"
+#include "ykcmp.h"
+
+/// Converts lines [line_begin, line_end) of slices [slice_begin, slice_end). Distinct line ranges
+/// touch distinct bytes on both sides, so callers may run them concurrently.
+struct SwizzleRange {
+    u32 slice_begin;
+    u32 slice_end;
+    u32 line_begin;
+    u32 line_end;
+    /// Line of the whole linear level (slice * height + line) found at the start of the linear
+    /// buffer, so a window of lines can go through a small staging buffer.
+    u32 linear_origin = 0;
+    /// Byte of the block-linear level found at the start of the block-linear buffer, the same for
+    /// a window of whole block rows.
+    u32 swizzled_origin = 0;
+};
+
+/// Bytes in one row of GOB blocks of a level, and so the distance between consecutive block rows
+/// in the block-linear image.
+static u32 BlockRowSize(u32 bytes_per_pixel, u32 width, u32 block_height, u32 block_depth, u32 stride_alignment) {
+    const u32 stride = AlignUpLog2(width, stride_alignment) * bytes_per_pixel;
+    return DivCeilLog2(stride, GOB_SIZE_X_SHIFT) << (GOB_SIZE_SHIFT + block_height + block_depth);
+}
+
+/// BYTES_PER_PIXEL bakes the texel size in so edge copies become single loads and stores; 0 reads
+/// it from bytes_per_pixel instead.
+template <bool TO_LINEAR, u32 BYTES_PER_PIXEL>
+void SwizzleKernel(u8* output, u8* input, u32 bytes_per_pixel, u32 width,
+                   u32 height, u32 block_height, u32 block_depth, u32 stride_alignment,
+                   SwizzleRange range) {
+    if constexpr (BYTES_PER_PIXEL != 0) {
+        bytes_per_pixel = BYTES_PER_PIXEL;
+    }
 
-template <bool TO_LINEAR>
-void Swizzle(u8* output, u8* input, u32 bytes_per_pixel, u32 width,
-             u32 height, u32 depth, u32 block_height, u32 block_depth, u32 stride_alignment = 1) {
     // The origin of the transformation can be configured here, leave it as zero as the current API
-    // doesn't expose it.
-    static constexpr u32 origin_x = 0;
+    // doesn't expose it. The x origin is fixed at zero so lines start on a GOB sector boundary.
     static constexpr u32 origin_y = 0;
     static constexpr u32 origin_z = 0;
 
     // We can configure here a custom pitch
     // As it's not exposed 'width * bpp' will be the expected pitch.
     const u32 pitch = width * bytes_per_pixel;
-    const u32 stride = AlignUpLog2(width, stride_alignment) * bytes_per_pixel;
-
-    const u32 gobs_in_x = DivCeilLog2(stride, GOB_SIZE_X_SHIFT);
-    const u32 block_size = gobs_in_x << (GOB_SIZE_SHIFT + block_height + block_depth);
+    const u32 block_size = BlockRowSize(bytes_per_pixel, width, block_height, block_depth, stride_alignment);
     const u32 slice_size =
         DivCeilLog2(height, block_height + GOB_SIZE_Y_SHIFT) * block_size;
 
@@ -23,41 +58,133 @@ void Swizzle(u8* output, u8* input, u32 bytes_per_pixel, u32 width,
     const u32 block_depth_mask = (1U << block_depth) - 1;
     const u32 x_shift = GOB_SIZE_SHIFT + block_height + block_depth;
 
-    for (u32 slice = 0; slice < depth; ++slice) {
+    // Texels never straddle a sector when the texel size divides it, which holds for every
+    // power-of-two format. Other sizes keep the per-texel path for the whole line.
+    const u32 sector_end = GOB_SECTOR_SIZE % bytes_per_pixel == 0 ? pitch & ~(GOB_SECTOR_SIZE - 1) : 0;
+    const u32 gob_end = sector_end & ~(GOB_SIZE_X - 1);
+
+    const auto copy = [output, input](u32 swizzled_offset, u32 unswizzled_offset, u32 size) {
+        std::memcpy(&output[TO_LINEAR ? swizzled_offset : unswizzled_offset],
+                    &input[TO_LINEAR ? unswizzled_offset : swizzled_offset],
+                    size);
+    };
+
+    const GobKernels& kernels = GetGobKernels();
+
+    for (u32 slice = range.slice_begin; slice < range.slice_end; ++slice) {
         const u32 z = slice + origin_z;
         const u32 offset_z = (z >> block_depth) * slice_size +
-            ((z & block_depth_mask) << (GOB_SIZE_SHIFT + block_height));
-        for (u32 line = 0; line < height; ++line) {
-            const u32 y = line + origin_y;
-            const auto& table = SWIZZLE_TABLE[y % GOB_SIZE_Y];
+            ((z & block_depth_mask) << (GOB_SIZE_SHIFT + block_height)) - range.swizzled_origin;
+        const u32 first_line = slice * height - range.linear_origin;
 
+        const auto line_offset = [&](u32 y) {
             const u32 block_y = y >> GOB_SIZE_Y_SHIFT;
-            const u32 offset_y = (block_y >> block_height) * block_size +
+            return offset_z + (block_y >> block_height) * block_size +
                 ((block_y & block_height_mask) << GOB_SIZE_SHIFT);
+        };
 
-            for (u32 column = 0; column < width; ++column) {
-                const u32 x = (column + origin_x) * bytes_per_pixel;
-                const u32 offset_x = (x >> GOB_SIZE_X_SHIFT) << x_shift;
+        // Copies one line from x onwards. A GOB line is four 16-byte sectors, each contiguous in
+        // both layouts, so whole sectors move at once and only a ragged edge goes per texel.
+        const auto copy_line = [&](u32 line, u32 x) {
+            const u32 y = line + origin_y;
+            const auto& table = SWIZZLE_TABLE[y % GOB_SIZE_Y];
+            const u32 base_swizzled_offset = line_offset(y);
+            const u32 unswizzled_line = (first_line + line) * pitch;
 
-                const u32 base_swizzled_offset = offset_z + offset_y + offset_x;
-                const u32 swizzled_offset = base_swizzled_offset + table[x % GOB_SIZE_X];
+            for (; x < sector_end; x += GOB_SECTOR_SIZE) {
+                const u32 offset_x = (x >> GOB_SIZE_X_SHIFT) << x_shift;
+                copy(base_swizzled_offset + offset_x + table[x % GOB_SIZE_X], unswizzled_line + x,
+                     GOB_SECTOR_SIZE);
+            }
+            for (; x < pitch; x += bytes_per_pixel) {
+                const u32 offset_x = (x >> GOB_SIZE_X_SHIFT) << x_shift;
+                copy(base_swizzled_offset + offset_x + table[x % GOB_SIZE_X], unswizzled_line + x,
+                     bytes_per_pixel);
+            }
+        };
 
-                const u32 unswizzled_offset =
-                    slice * pitch * height + line * pitch + column * bytes_per_pixel;
+        u32 line = range.line_begin;
+        while (line < range.line_end) {
+            const u32 y = line + origin_y;
+            if (y % GOB_SIZE_Y != 0 || line + GOB_SIZE_Y > range.line_end || gob_end == 0) {
+                copy_line(line++, 0);
+                continue;
+            }
 
-                std::memcpy(&output[TO_LINEAR ? swizzled_offset : unswizzled_offset], 
-                            &input[TO_LINEAR ? unswizzled_offset : swizzled_offset], 
-                            bytes_per_pixel);
+            // Eight lines starting on a GOB boundary: whole GOBs go through the vector kernel and
+            // the partial GOB on the right falls back to line copies.
+            const u32 base_swizzled_offset = line_offset(y);
+            const u32 unswizzled_line = (first_line + line) * pitch;
+            for (u32 x = 0; x < gob_end; x += GOB_SIZE_X) {
+                u8* gob = (TO_LINEAR ? output : input) + base_swizzled_offset +
+                    ((x >> GOB_SIZE_X_SHIFT) << x_shift);
+                if constexpr (TO_LINEAR) {
+                    kernels.swizzle(gob, input + unswizzled_line + x, pitch);
+                } else {
+                    kernels.unswizzle(output + unswizzled_line + x, pitch, gob);
+                }
             }
+            if (gob_end < pitch) {
+                for (u32 row = 0; row < GOB_SIZE_Y; ++row) copy_line(line + row, gob_end);
+            }
+            line += GOB_SIZE_Y;
         }
     }
 }
 
-extern "C" __declspec(dllexport)
-void UnswizzleImage(u8* src, u8* dst,
-                    u32 width, u32 height, u32 depth, u32 mipmaps,
-                    u32 fmt, u32 tile_width_spacing, u32 block_height) {
-    const auto format = static_cast<PixelFormat>(fmt);
+/// Dispatches to a kernel specialised for the texel size. BytesPerBlockLog2 only yields 1 to 16
+/// bytes, so anything else is the 96-bit format going through the generic kernel.
+template <bool TO_LINEAR>
+void Swizzle(u8* output, u8* input, u32 bytes_per_pixel, u32 width,
+             u32 height, u32 block_height, u32 block_depth, u32 stride_alignment,
+             SwizzleRange range) {
+    switch (bytes_per_pixel) {
+        case 1:
+            return SwizzleKernel<TO_LINEAR, 1>(output, input, bytes_per_pixel, width, height,
+                                               block_height, block_depth, stride_alignment, range);
+        case 2:
+            return SwizzleKernel<TO_LINEAR, 2>(output, input, bytes_per_pixel, width, height,
+                                               block_height, block_depth, stride_alignment, range);
+        case 4:
+            return SwizzleKernel<TO_LINEAR, 4>(output, input, bytes_per_pixel, width, height,
+                                               block_height, block_depth, stride_alignment, range);
+        case 8:
+            return SwizzleKernel<TO_LINEAR, 8>(output, input, bytes_per_pixel, width, height,
+                                               block_height, block_depth, stride_alignment, range);
+        case 16:
+            return SwizzleKernel<TO_LINEAR, 16>(output, input, bytes_per_pixel, width, height,
+                                                block_height, block_depth, stride_alignment, range);
+        default:
+            return SwizzleKernel<TO_LINEAR, 0>(output, input, bytes_per_pixel, width, height,
+                                               block_height, block_depth, stride_alignment, range);
+    }
+}
+
+/// Where one mip level sits in the linear and block-linear images, and how to convert it.
+struct SwizzleLevel {
+    u32 host_offset;          ///< Start of the level in the linear image, layer 0
+    u32 host_bytes_per_layer; ///< Distance between the level's layers in the linear image
+    u32 guest_offset;         ///< Start of the level within a block-linear layer
+    Extent3D size;            ///< In pixels
+    Extent3D num_tiles;
+    Extent3D block;
+    u32 stride_alignment;
+};
+
+/// Layout of a whole texture. The linear image stores each level's layers back to back, level
+/// after level; the block-linear image stores each layer's mip chain, layer_stride apart.
+struct SwizzleLayout {
+    std::vector<SwizzleLevel> levels;
+    u32 bytes_per_pixel;
+    u32 layers;
+    u32 layer_stride;
+    u32 linear_size;
+    u32 swizzled_size;
+};
+
+static SwizzleLayout MakeSwizzleLayout(PixelFormat format, u32 width, u32 height, u32 depth,
+                                       u32 mipmaps, u32 layers, u32 tile_width_spacing,
+                                       u32 block_height) {
     const auto bytes_per_block = BytesPerBlock(format);
     const u32 bpp_log2 = BytesPerBlockLog2(bytes_per_block);
     const Extent3D size = {.width = width, .height = height, .depth = depth};
@@ -71,9 +198,14 @@ void UnswizzleImage(u8* src, u8* dst,
     const u32 layer_size = CalculateLevelBytes(level_sizes, num_levels);
     const u32 layer_stride = AlignLayerSize(layer_size, size, level_info.block, tile_size.height,
                                             tile_width_spacing);
-    size_t guest_offset = 0;
+    u32 guest_offset = 0;
     u32 host_offset = 0;
 
+    SwizzleLayout layout{};
+    layout.bytes_per_pixel = 1U << bpp_log2;
+    layout.layers = layers;
+    layout.layer_stride = layer_stride;
+    layout.levels.reserve(num_levels);
     for (s32 level = 0; level < num_levels; ++level) {
         const Extent3D level_size = AdjustMipSize(size, level);
         const u32 num_blocks_per_layer = NumBlocks(level_size, tile_size);
@@ -82,40 +214,549 @@ void UnswizzleImage(u8* src, u8* dst,
         const Extent3D num_tiles = AdjustTileSize(level_size, tile_size);
         const Extent3D block = AdjustMipBlockSize(num_tiles, level_info.block, level);
         const u32 stride_alignment = StrideAlignment(num_tiles, block, gob, bpp_log2);
+        layout.levels.push_back({host_offset, host_bytes_per_layer, guest_offset, level_size, num_tiles,
+                                 block, stride_alignment});
 
-        Swizzle<false>(dst + host_offset, src + guest_offset, 
-                        1U << bpp_log2, num_tiles.width, num_tiles.height,
-                        num_tiles.depth, block.height, block.depth, stride_alignment);
-
-        host_offset += host_bytes_per_layer;
+        host_offset += host_bytes_per_layer * layers;
         guest_offset += level_sizes[level];
     }
+    layout.linear_size = host_offset;
+    // A single layer has nothing after it to align for.
+    layout.swizzled_size = layers > 1 ? layer_stride * layers : layer_size;
+    return layout;
 }
 
-extern "C" __declspec(dllexport)
-void SwizzleImage(u8 * src, u8 * dst,
-                    u32 width, u32 height, u32 depth, u32 mipmaps,
-                    u32 fmt, u32 tile_width_spacing, u32 block_height) {
+// Below this much data the thread start-up costs more than the copy.
+constexpr u32 SWIZZLE_PARALLEL_MIN_BYTES = 1U << 20;
+
+/// Everything needed to convert textures with one set of parameters: the level layout and the
+/// work split, one task per block row (the lines sharing a row of GOB blocks) of every slice of
+/// every layer so a single large level still spreads across threads. Archives repeat the same few
+/// shapes thousands of times, so plans are built once and cached.
+struct SwizzlePlan {
+    struct Key {
+        constexpr auto operator<=>(const Key&) const noexcept = default;
+        u32 width;
+        u32 height;
+        u32 depth;
+        u32 mipmaps;
+        u32 layers;
+        u32 fmt;
+        u32 tile_width_spacing;
+        u32 block_height;
+    };
+
+    struct Task {
+        u32 level;
+        u32 layer;
+        SwizzleRange range;
+    };
+
+    explicit SwizzlePlan(const Key& key_)
+        : key(key_), layout(MakeSwizzleLayout(static_cast<PixelFormat>(key.fmt), key.width, key.height, key.depth,
+                                   key.mipmaps, key.layers, key.tile_width_spacing, key.block_height)) {
+        for (u32 level = 0; level < layout.levels.size(); ++level) {
+            const Extent3D& num_tiles = layout.levels[level].num_tiles;
+            const u32 block_row_lines = GOB_SIZE_Y << layout.levels[level].block.height;
+            for (u32 layer = 0; layer < layout.layers; ++layer) {
+                for (u32 slice = 0; slice < num_tiles.depth; ++slice) {
+                    for (u32 line = 0; line < num_tiles.height; line += block_row_lines) {
+                        tasks.push_back({level, layer,
+                                         {slice, slice + 1, line, std::min(line + block_row_lines, num_tiles.height)}});
+                    }
+                }
+            }
+        }
+    }
+
+    template <bool TO_LINEAR>
+    void Run(u8* swizzled, u8* linear, u32 num_threads) const {
+        if (layout.linear_size < SWIZZLE_PARALLEL_MIN_BYTES) num_threads = 1;
+        // Level 0 comes first and is the largest, so tasks are already handed out biggest first.
+        ParallelFor(static_cast<u32>(tasks.size()), num_threads, [&](u32 i) {
+            const Task& task = tasks[i];
+            const SwizzleLevel& level = layout.levels[task.level];
+            u8* const level_linear = linear + level.host_offset + task.layer * level.host_bytes_per_layer;
+            u8* const level_swizzled = swizzled + static_cast<size_t>(task.layer) * layout.layer_stride +
+                level.guest_offset;
+            Swizzle<TO_LINEAR>(TO_LINEAR ? level_swizzled : level_linear, TO_LINEAR ? level_linear : level_swizzled,
+                               layout.bytes_per_pixel, level.num_tiles.width, level.num_tiles.height,
+                               level.block.height, level.block.depth, level.stride_alignment, task.range);
+        });
+    }
+
+    Key key;
+    SwizzleLayout layout;
+    std::vector<Task> tasks;
+};
+
+// Distinct texture shapes kept around; a plan is a few hundred bytes plus one task per block row.
+constexpr u32 SWIZZLE_PLAN_CACHE_SIZE = 256;
+
+/// Least recently used plans, shared by every thread. Plans are handed out as shared_ptr so one
+/// evicted while another thread is still running it stays alive until that thread is done.
+class SwizzlePlanCache {
+public:
+    std::shared_ptr<const SwizzlePlan> Get(const SwizzlePlan::Key& key) {
+        {
+            std::scoped_lock lock{mutex};
+            if (const auto it = index.find(key); it != index.end()) {
+                plans.splice(plans.begin(), plans, it->second);
+                return *it->second;
+            }
+        }
+
+        // Build outside the lock; if another thread raced us to the same key, keep its plan.
+        auto plan = std::make_shared<const SwizzlePlan>(key);
+        std::scoped_lock lock{mutex};
+        if (capacity == 0) return plan;
+        if (const auto it = index.find(key); it != index.end()) return *it->second;
+        plans.push_front(plan);
+        index.emplace(key, plans.begin());
+        Trim();
+        return plan;
+    }
+
+    void SetCapacity(u32 new_capacity) {
+        std::scoped_lock lock{mutex};
+        capacity = new_capacity;
+        Trim();
+    }
+
+private:
+    void Trim() {
+        while (plans.size() > capacity) {
+            index.erase(plans.back()->key);
+            plans.pop_back();
+        }
+    }
+
+    std::mutex mutex;
+    std::list<std::shared_ptr<const SwizzlePlan>> plans; ///< Most recently used first
+    std::map<SwizzlePlan::Key, std::list<std::shared_ptr<const SwizzlePlan>>::iterator> index;
+    u32 capacity = SWIZZLE_PLAN_CACHE_SIZE;
+};
+
+static SwizzlePlanCache plan_cache;
+
+static std::shared_ptr<const SwizzlePlan> GetSwizzlePlan(u32 width, u32 height, u32 depth, u32 mipmaps,
+                                                        u32 layers, u32 fmt, u32 tile_width_spacing,
+                                                        u32 block_height) {
+    return plan_cache.Get({width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height});
+}
+
+extern "C" YKCMP_API
+void SetSwizzlePlanCacheSize(u32 capacity) {
+    plan_cache.SetCapacity(capacity);
+}
+
+extern "C" YKCMP_API
+SwizzlePlan* CreateSwizzlePlan(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                               u32 fmt, u32 tile_width_spacing, u32 block_height) {
+    return new SwizzlePlan({width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height});
+}
+
+extern "C" YKCMP_API
+void DestroySwizzlePlan(SwizzlePlan* plan) {
+    delete plan;
+}
+
+extern "C" YKCMP_API
+void UnswizzleWithPlan(const SwizzlePlan* plan, u8* src, u8* dst, u32 num_threads) {
+    plan->Run<false>(src, dst, num_threads);
+}
+
+extern "C" YKCMP_API
+void SwizzleWithPlan(const SwizzlePlan* plan, u8* src, u8* dst, u32 num_threads) {
+    plan->Run<true>(dst, src, num_threads);
+}
+
+extern "C" YKCMP_API
+u32 SwizzlePlanUnswizzledSize(const SwizzlePlan* plan) {
+    return plan->layout.linear_size;
+}
+
+extern "C" YKCMP_API
+u32 SwizzlePlanSwizzledSize(const SwizzlePlan* plan) {
+    return plan->layout.swizzled_size;
+}
+
+extern "C" YKCMP_API
+void UnswizzleImageArray(u8* src, u8* dst,
+                         u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                         u32 fmt, u32 tile_width_spacing, u32 block_height, u32 num_threads) {
+    GetSwizzlePlan(width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height)
+        ->Run<false>(src, dst, num_threads);
+}
+
+extern "C" YKCMP_API
+void SwizzleImageArray(u8* src, u8* dst,
+                       u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                       u32 fmt, u32 tile_width_spacing, u32 block_height, u32 num_threads) {
+    GetSwizzlePlan(width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height)
+        ->Run<true>(dst, src, num_threads);
+}
+
+/// Pulls exactly size bytes of decompressed output, feeding the stream more input as it runs dry.
+/// out may be null to skip bytes.
+static s32 ReadStream(YKCMPStream* stream, const u8* in, u32 in_size, u32& in_pos, u8* out, u32 size,
+                      std::vector<u8>& scratch) {
+    u32 got = 0;
+    bool fed_nothing = false;
+    while (got < size) {
+        u8* const target = out ? out + got : scratch.data();
+        const u32 want = out ? size - got : std::min<u32>(size - got, static_cast<u32>(scratch.size()));
+        const u32 drained = decompress_stream_drain(stream, target, want);
+        got += drained;
+        if (drained > 0) fed_nothing = false;
+        if (drained == want) continue;
+
+        // A feed may consume nothing and still finish a match left pending, so the input has only
+        // run out once a feed that took no bytes was followed by nothing to drain.
+        if (fed_nothing) return YKCMP_ERROR_TRUNCATED;
+        const s32 consumed = decompress_stream_feed(stream, in + in_pos, in_size - in_pos);
+        if (consumed < 0) return consumed;
+        in_pos += static_cast<u32>(consumed);
+        fed_nothing = consumed == 0;
+    }
+    return YKCMP_OK;
+}
+
+/// Walks the block-linear image in memory order (layer, level, slice block, block row) and
+/// unswizzles each block row as soon as the decoder has produced it, while it is still in cache.
+/// Only one block row of the block-linear image is ever held outside the stream's own window.
+extern "C" YKCMP_API
+s32 DecompressUnswizzleImage(const u8* in, u32 in_size, u32 image_offset, u8* dst,
+                             u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                             u32 fmt, u32 tile_width_spacing, u32 block_height) {
+    if (!IsValidImageShape(width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height)) {
+        return YKCMP_ERROR_FORMAT;
+    }
+    const auto plan = GetSwizzlePlan(width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height);
+    const SwizzleLayout& layout = plan->layout;
+
+    if (in_size < sizeof(YKCMP_HDR)) return YKCMP_ERROR_HEADER;
+    YKCMP_HDR hdr{};
+    std::memcpy(&hdr, in, sizeof(YKCMP_HDR));
+    if (hdr.decompSize < image_offset || hdr.decompSize - image_offset < layout.swizzled_size) {
+        return YKCMP_ERROR_SIZE_MISMATCH;
+    }
+
+    // Level 0 has the widest block rows, so its row sizes the staging buffer for every level.
+    const SwizzleLevel& first = layout.levels[0];
+    thread_local std::vector<u8> staging;
+    staging.resize(BlockRowSize(layout.bytes_per_pixel, first.num_tiles.width, first.block.height,
+                                first.block.depth, first.stride_alignment));
+
+    YKCMPStream* const stream = decompress_stream_init();
+    u32 in_pos = 0;
+    u32 position = 0; ///< Bytes of decompressed output read so far
+    const auto skip_to = [&](u32 target) {
+        const s32 status = ReadStream(stream, in, in_size, in_pos, nullptr, target - position, staging);
+        position = target;
+        return status;
+    };
+
+    s32 status = skip_to(image_offset);
+    for (u32 layer = 0; layer < layout.layers && status == YKCMP_OK; ++layer) {
+        const u32 layer_start = image_offset + layer * layout.layer_stride;
+        for (const SwizzleLevel& level : layout.levels) {
+            status = skip_to(layer_start + level.guest_offset);
+            if (status != YKCMP_OK) break;
+
+            const Extent3D& tiles = level.num_tiles;
+            const u32 row_size = BlockRowSize(layout.bytes_per_pixel, tiles.width, level.block.height,
+                                              level.block.depth, level.stride_alignment);
+            const u32 row_lines = GOB_SIZE_Y << level.block.height;
+            const u32 slices_per_block = 1U << level.block.depth;
+            u8* const level_linear = dst + level.host_offset + layer * level.host_bytes_per_layer;
+
+            u32 origin = 0;
+            for (u32 slice = 0; slice < tiles.depth && status == YKCMP_OK; slice += slices_per_block) {
+                for (u32 line = 0; line < tiles.height; line += row_lines, origin += row_size) {
+                    status = ReadStream(stream, in, in_size, in_pos, staging.data(), row_size, staging);
+                    if (status != YKCMP_OK) break;
+                    position += row_size;
+
+                    const SwizzleRange window{slice, std::min(slice + slices_per_block, tiles.depth), line,
+                                              std::min(line + row_lines, tiles.height), 0, origin};
+                    Swizzle<false>(level_linear, staging.data(), layout.bytes_per_pixel, tiles.width,
+                                   tiles.height, level.block.height, level.block.depth,
+                                   level.stride_alignment, window);
+                }
+            }
+            if (status != YKCMP_OK) break;
+        }
+    }
+    // Whatever follows the image is still decoded, so a corrupt tail is reported like anywhere else.
+    if (status == YKCMP_OK) status = skip_to(hdr.decompSize);
+
+    const s32 finished = decompress_stream_finish(stream);
+    return status != YKCMP_OK ? status : finished;
+}
+
+/// Decoded levels follow the linear layout: every layer of level 0, then of level 1 and so on.
+static std::vector<u32> DecodedLevelOffsets(const SwizzleLayout& layout, u32 out_bpp, u32& decoded_size) {
+    std::vector<u32> offsets(layout.levels.size());
+    decoded_size = 0;
+    for (size_t level = 0; level < layout.levels.size(); ++level) {
+        offsets[level] = decoded_size;
+        const Extent3D& size = layout.levels[level].size;
+        decoded_size += size.width * size.height * size.depth * out_bpp * layout.layers;
+    }
+    return offsets;
+}
+
+/// Unswizzles a level GOB row by GOB row into a small staging buffer and decodes each row of
+/// blocks from there, so the decoded image is written without a full linear copy in between.
+extern "C" YKCMP_API
+bool DecodeImage(u8* src, u8* dst,
+                 u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                 u32 fmt, u32 tile_width_spacing, u32 block_height, u32 num_threads) {
     const auto format = static_cast<PixelFormat>(fmt);
-    const auto bytes_per_block = BytesPerBlock(format);
-    const u32 bpp_log2 = BytesPerBlockLog2(bytes_per_block);
+    const PixelDecoder* decoder = FindPixelDecoder(format);
+    if (!decoder) return false;
+
+    const auto plan = GetSwizzlePlan(width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height);
+    const SwizzleLayout& layout = plan->layout;
+    const Extent2D block = DefaultBlockSize(format);
+    const u32 out_bpp = decoder->out_bytes_per_pixel;
+
+    u32 decoded_size;
+    const std::vector<u32> decoded_offsets = DecodedLevelOffsets(layout, out_bpp, decoded_size);
+
+    const u32 threads = decoded_size < SWIZZLE_PARALLEL_MIN_BYTES ? 1 : num_threads;
+    ParallelFor(static_cast<u32>(plan->tasks.size()), threads, [&](u32 i) {
+        const SwizzlePlan::Task& task = plan->tasks[i];
+        const SwizzleLevel& level = layout.levels[task.level];
+        const Extent3D& size = level.size;
+        const u32 pitch = level.num_tiles.width * layout.bytes_per_pixel;
+        const u32 out_pitch = size.width * out_bpp;
+        u8* const level_swizzled = src + static_cast<size_t>(task.layer) * layout.layer_stride + level.guest_offset;
+        u8* const level_out = dst + decoded_offsets[task.level] +
+            task.layer * size.width * size.height * size.depth * out_bpp;
+
+        thread_local std::vector<u8> staging;
+        staging.resize(GOB_SIZE_Y * pitch);
+
+        const u32 slice = task.range.slice_begin;
+        for (u32 line = task.range.line_begin; line < task.range.line_end; line += GOB_SIZE_Y) {
+            const u32 rows = std::min(GOB_SIZE_Y, task.range.line_end - line);
+            const SwizzleRange window{slice, slice + 1, line, line + rows, slice * level.num_tiles.height + line};
+            Swizzle<false>(staging.data(), level_swizzled, layout.bytes_per_pixel, level.num_tiles.width,
+                           level.num_tiles.height, level.block.height, level.block.depth,
+                           level.stride_alignment, window);
+
+            for (u32 row = 0; row < rows; ++row) {
+                const u32 y = (line + row) * block.height;
+                u8* const out = level_out + (slice * size.height + y) * out_pitch;
+                DecodeBlockRow(*decoder, staging.data() + row * pitch, layout.bytes_per_pixel, block, out,
+                               out_pitch, size.width, std::min(block.height, size.height - y));
+            }
+        }
+    });
+    return true;
+}
+
+/// Same as DecodeImage for a texture that was already unswizzled. Each task decodes a GOB's worth
+/// of block rows, to keep the split the same as the block-linear path.
+extern "C" YKCMP_API
+bool DecodeLinearImage(u8* src, u8* dst,
+                       u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                       u32 fmt, u32 num_threads) {
+    const auto format = static_cast<PixelFormat>(fmt);
+    const PixelDecoder* decoder = FindPixelDecoder(format);
+    if (!decoder) return false;
+
+    const SwizzleLayout layout = MakeSwizzleLayout(format, width, height, depth, mipmaps, layers, 0, 0);
+    const Extent2D block = DefaultBlockSize(format);
+    const u32 out_bpp = decoder->out_bytes_per_pixel;
+    u32 decoded_size;
+    const std::vector<u32> decoded_offsets = DecodedLevelOffsets(layout, out_bpp, decoded_size);
+
+    struct Task {
+        u32 level;
+        u32 image; ///< layer * depth + slice
+        u32 line_begin;
+        u32 line_end;
+    };
+    std::vector<Task> tasks;
+    for (u32 level = 0; level < layout.levels.size(); ++level) {
+        const Extent3D& num_tiles = layout.levels[level].num_tiles;
+        for (u32 image = 0; image < layers * num_tiles.depth; ++image) {
+            for (u32 line = 0; line < num_tiles.height; line += GOB_SIZE_Y) {
+                tasks.push_back({level, image, line, std::min(line + GOB_SIZE_Y, num_tiles.height)});
+            }
+        }
+    }
+
+    const u32 threads = decoded_size < SWIZZLE_PARALLEL_MIN_BYTES ? 1 : num_threads;
+    ParallelFor(static_cast<u32>(tasks.size()), threads, [&](u32 i) {
+        const Task& task = tasks[i];
+        const SwizzleLevel& level = layout.levels[task.level];
+        const Extent3D& size = level.size;
+        const u32 pitch = level.num_tiles.width * layout.bytes_per_pixel;
+        const u32 out_pitch = size.width * out_bpp;
+        // Layers of a level are back to back on both sides, so layer and slice index together.
+        const u8* const image_in = src + level.host_offset + task.image * level.num_tiles.height * pitch;
+        u8* const image_out = dst + decoded_offsets[task.level] + task.image * size.height * out_pitch;
+        for (u32 line = task.line_begin; line < task.line_end; ++line) {
+            const u32 y = line * block.height;
+            DecodeBlockRow(*decoder, image_in + line * pitch, layout.bytes_per_pixel, block,
+                           image_out + y * out_pitch, out_pitch, size.width, std::min(block.height, size.height - y));
+        }
+    });
+    return true;
+}
+
+/// The reverse of DecodeImage: encodes a level a GOB row of blocks at a time into a small staging
+/// buffer and swizzles it from there. Encoding costs far more than thread start-up, so even small
+/// textures are split across threads.
+extern "C" YKCMP_API
+bool EncodeImage(u8* src, u8* dst,
+                 u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                 u32 fmt, u32 tile_width_spacing, u32 block_height, u32 quality, u32 num_threads) {
+    const auto format = static_cast<PixelFormat>(fmt);
+    const EncodeRowFn encoder = FindBlockEncoder(format);
+    if (!encoder) return false;
+
+    const auto plan = GetSwizzlePlan(width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height);
+    const SwizzleLayout& layout = plan->layout;
+    constexpr u32 in_bpp = 4;
+    u32 decoded_size;
+    const std::vector<u32> decoded_offsets = DecodedLevelOffsets(layout, in_bpp, decoded_size);
+
+    ParallelFor(static_cast<u32>(plan->tasks.size()), num_threads, [&](u32 i) {
+        const SwizzlePlan::Task& task = plan->tasks[i];
+        const SwizzleLevel& level = layout.levels[task.level];
+        const Extent3D& size = level.size;
+        const u32 pitch = level.num_tiles.width * layout.bytes_per_pixel;
+        const u32 in_pitch = size.width * in_bpp;
+        u8* const level_swizzled = dst + static_cast<size_t>(task.layer) * layout.layer_stride + level.guest_offset;
+        const u8* const level_in = src + decoded_offsets[task.level] +
+            task.layer * size.width * size.height * size.depth * in_bpp;
+
+        thread_local std::vector<u8> staging;
+        staging.resize(GOB_SIZE_Y * pitch);
+
+        const u32 slice = task.range.slice_begin;
+        for (u32 line = task.range.line_begin; line < task.range.line_end; line += GOB_SIZE_Y) {
+            const u32 rows = std::min(GOB_SIZE_Y, task.range.line_end - line);
+            for (u32 row = 0; row < rows; ++row) {
+                const u32 y = (line + row) * 4;
+                EncodeBlockRow(encoder, level_in + (slice * size.height + y) * in_pitch, in_pitch, size.width,
+                               std::min(4U, size.height - y), staging.data() + row * pitch, layout.bytes_per_pixel,
+                               quality);
+            }
+
+            const SwizzleRange window{slice, slice + 1, line, line + rows, slice * level.num_tiles.height + line};
+            Swizzle<true>(level_swizzled, staging.data(), layout.bytes_per_pixel, level.num_tiles.width,
+                          level.num_tiles.height, level.block.height, level.block.depth,
+                          level.stride_alignment, window);
+        }
+    });
+    return true;
+}
+
+extern "C" YKCMP_API
+u32 DecodedImageSize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers, u32 fmt) {
+    const PixelDecoder* decoder = FindPixelDecoder(static_cast<PixelFormat>(fmt));
+    if (!decoder) return 0;
+
     const Extent3D size = {.width = width, .height = height, .depth = depth};
-    const Extent3D block2 = {.width = 0, .height = block_height, .depth = 0};
+    u32 decoded_size = 0;
+    for (s32 level = 0; level < static_cast<s32>(mipmaps); ++level) {
+        const Extent3D level_size = AdjustMipSize(size, level);
+        decoded_size += level_size.width * level_size.height * level_size.depth;
+    }
+    return decoded_size * layers * decoder->out_bytes_per_pixel;
+}
 
-    const LevelInfo level_info = MakeLevelInfo(static_cast<PixelFormat>(format), size, block2, bytes_per_block, tile_width_spacing);
-    const Extent2D tile_size = DefaultBlockSize(format);
+extern "C" YKCMP_API
+void UnswizzleImageParallel(u8* src, u8* dst,
+                            u32 width, u32 height, u32 depth, u32 mipmaps,
+                            u32 fmt, u32 tile_width_spacing, u32 block_height, u32 num_threads) {
+    UnswizzleImageArray(src, dst, width, height, depth, mipmaps, 1, fmt, tile_width_spacing,
+                        block_height, num_threads);
+}
 
-    const s32 level = 0;
-    const Extent3D level_size = AdjustMipSize(size, level);
-    const u32 num_blocks_per_layer = NumBlocks(level_size, tile_size);
-    const u32 host_bytes_per_layer = num_blocks_per_layer << bpp_log2;
+extern "C" YKCMP_API
+void UnswizzleImage(u8* src, u8* dst,
+                    u32 width, u32 height, u32 depth, u32 mipmaps,
+                    u32 fmt, u32 tile_width_spacing, u32 block_height) {
+    UnswizzleImageArray(src, dst, width, height, depth, mipmaps, 1, fmt, tile_width_spacing,
+                        block_height, 1);
+}
 
-    const Extent2D gob = GobSize(bpp_log2, block_height, tile_width_spacing);
-    const Extent3D num_tiles = AdjustTileSize(level_size, tile_size);
-    const Extent3D block = AdjustMipBlockSize(num_tiles, level_info.block, level);
-    const u32 stride_alignment = StrideAlignment(num_tiles, block, gob, bpp_log2);
+extern "C" YKCMP_API
+void SwizzleImage(u8* src, u8* dst,
+                  u32 width, u32 height, u32 depth, u32 mipmaps,
+                  u32 fmt, u32 tile_width_spacing, u32 block_height) {
+    SwizzleImageArray(src, dst, width, height, depth, mipmaps, 1, fmt, tile_width_spacing,
+                      block_height, 1);
+}
+
+extern "C" YKCMP_API
+u32 UnswizzledArraySize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers, u32 fmt) {
+    // The linear size doesn't depend on the block-linear parameters.
+    return MakeSwizzleLayout(static_cast<PixelFormat>(fmt), width, height, depth, mipmaps, layers, 0, 0)
+        .linear_size;
+}
+
+extern "C" YKCMP_API
+u32 SwizzledArraySize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                      u32 fmt, u32 tile_width_spacing, u32 block_height) {
+    return GetSwizzlePlan(width, height, depth, mipmaps, layers, fmt, tile_width_spacing, block_height)
+        ->layout.swizzled_size;
+}
 
-    Swizzle<true>(dst, src, bytes_per_block, num_tiles.width, num_tiles.height,
-                    num_tiles.depth, block.height, block.depth, stride_alignment);
+extern "C" YKCMP_API
+bool IsValidImageShape(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                       u32 fmt, u32 tile_width_spacing, u32 block_height) {
+    if (fmt >= MaxPixelFormat || width == 0 || height == 0 || depth == 0 ||
+        mipmaps == 0 || mipmaps > std::tuple_size_v<LevelArray> || layers == 0 ||
+        block_height > MAX_BLOCK_HEIGHT || tile_width_spacing > MAX_TILE_WIDTH_SPACING) {
+        return false;
+    }
+
+    // Bound the sizes in u64 before the u32 layout math can wrap: every level padded to whole
+    // blocks of GOBs at the full block height and spacing, every layer to the layer alignment.
+    // Factors are clamped to just over the limit, so no product or sum here overflows.
+    constexpr u64 LIMIT = INT32_MAX;
+    const auto mul = [](u64 a, u64 b) { return a > LIMIT || b > LIMIT ? LIMIT + 1 : a * b; };
+
+    const auto format = static_cast<PixelFormat>(fmt);
+    const u64 bytes_per_block = 1ULL << BytesPerBlockLog2(BytesPerBlock(format));
+    const Extent2D tile_size = DefaultBlockSize(format);
+    const u64 row_alignment = u64{GOB_SIZE_X} << tile_width_spacing;
+    const u64 line_alignment = u64{GOB_SIZE_Y} << block_height;
+    u64 swizzled_size = 0;
+    u64 num_pixels = 0;
+    for (u32 level = 0; level < mipmaps; ++level) {
+        const u64 level_width = AdjustMipSize(width, level);
+        const u64 level_height = AdjustMipSize(height, level);
+        const u64 level_depth = AdjustMipSize(depth, level);
+        const u64 row_bytes = AlignUp(DivCeil(level_width, u64{tile_size.width}) * bytes_per_block, row_alignment);
+        const u64 lines = AlignUp(DivCeil(level_height, u64{tile_size.height}), line_alignment);
+        swizzled_size += mul(mul(row_bytes, lines), level_depth);
+        num_pixels += mul(mul(level_width, level_height), level_depth);
+    }
+    const u64 layer_alignment = 1ULL << (GOB_SIZE_SHIFT + tile_width_spacing + block_height);
+    swizzled_size = mul(swizzled_size + layer_alignment, layers);
+
+    // The linear image never exceeds the padded block-linear bound; the decoded one is per pixel.
+    const PixelDecoder* decoder = FindPixelDecoder(format);
+    const u64 decoded_size = decoder ? mul(mul(num_pixels, layers), decoder->out_bytes_per_pixel) : 0;
+    return swizzled_size <= LIMIT && decoded_size <= LIMIT;
+}
+
+extern "C" YKCMP_API
+u32 UnswizzledImageSize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 fmt) {
+    return UnswizzledArraySize(width, height, depth, mipmaps, 1, fmt);
+}
 
+extern "C" YKCMP_API
+u32 SwizzledImageSize(u32 width, u32 height, u32 depth, u32 mipmaps,
+                      u32 fmt, u32 tile_width_spacing, u32 block_height) {
+    return SwizzledArraySize(width, height, depth, mipmaps, 1, fmt, tile_width_spacing, block_height);
 }
@@ -1,5 +1,11 @@
+#pragma once
+
 #include "Util.h"
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <climits>
+#include <cstring>
 #include <span>
 #include <tuple>
 #include <numeric>
@@ -330,6 +336,10 @@ constexpr u32 GOB_SIZE_Z = 1;
 constexpr u32 GOB_SIZE_SHIFT = 9;
 constexpr u32 GOB_SIZE_X_SHIFT = 6;
 constexpr u32 GOB_SIZE_Y_SHIFT = 3;
+constexpr u32 GOB_SECTOR_SIZE = 16;
+/// Largest block_height (in log2 GOBs) and tile_width_spacing the hardware encodes.
+constexpr u32 MAX_BLOCK_HEIGHT = 5;
+constexpr u32 MAX_TILE_WIDTH_SPACING = 7;
 
 struct Extent2D {
     constexpr auto operator<=>(const Extent2D&) const noexcept = default;
@@ -528,7 +538,7 @@ constexpr SwizzleTable SWIZZLE_TABLE = MakeSwizzleTable();
     return sizes;
 }
 
-[[nodiscard]] u32 CalculateLevelBytes(const LevelArray& sizes, u32 num_levels) {
+[[nodiscard]] inline u32 CalculateLevelBytes(const LevelArray& sizes, u32 num_levels) {
     return std::reduce(sizes.begin(), sizes.begin() + num_levels, 0U);
 }
 
@@ -584,4 +594,93 @@ template <u32 GOB_EXTENT>
     } else {
         return gob.width;
     }
+}
+
+extern "C" {
+YKCMP_API void UnswizzleImage(u8* src, u8* dst,
+                              u32 width, u32 height, u32 depth, u32 mipmaps,
+                              u32 fmt, u32 tile_width_spacing, u32 block_height);
+YKCMP_API void SwizzleImage(u8* src, u8* dst,
+                            u32 width, u32 height, u32 depth, u32 mipmaps,
+                            u32 fmt, u32 tile_width_spacing, u32 block_height);
+
+/// UnswizzleImage on up to num_threads threads (0 means one per core). Work is split by mip level
+/// and block row; images under 1 MiB run on the calling thread alone.
+YKCMP_API void UnswizzleImageParallel(u8* src, u8* dst,
+                                      u32 width, u32 height, u32 depth, u32 mipmaps,
+                                      u32 fmt, u32 tile_width_spacing, u32 block_height,
+                                      u32 num_threads);
+
+/// Both directions for arrays and cubemaps (6 layers). The block-linear image holds each layer's
+/// full mip chain, layers aligned to the layer stride; the linear image holds every layer of level
+/// 0, then every layer of level 1 and so on. Threads are used as in UnswizzleImageParallel.
+YKCMP_API void UnswizzleImageArray(u8* src, u8* dst,
+                                   u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                                   u32 fmt, u32 tile_width_spacing, u32 block_height,
+                                   u32 num_threads);
+YKCMP_API void SwizzleImageArray(u8* src, u8* dst,
+                                 u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                                 u32 fmt, u32 tile_width_spacing, u32 block_height,
+                                 u32 num_threads);
+
+/// UnswizzleImageArray for a block-linear image inside a YKCMP blob, image_offset bytes into its
+/// decompressed data. Each block row is unswizzled into dst as soon as it is decompressed, so the
+/// block-linear image is never held in full. Returns YKCMP_OK or a negative YKCMPError, with
+/// YKCMP_ERROR_SIZE_MISMATCH if the blob is too small for the image and YKCMP_ERROR_FORMAT for a
+/// shape IsValidImageShape rejects.
+YKCMP_API s32 DecompressUnswizzleImage(const u8* in, u32 in_size, u32 image_offset, u8* dst,
+                                       u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                                       u32 fmt, u32 tile_width_spacing, u32 block_height);
+
+/// Size in bytes of the linear (UnswizzleImage output) and block-linear (UnswizzleImage input)
+/// images with these parameters, all mip levels included.
+YKCMP_API u32 UnswizzledImageSize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 fmt);
+YKCMP_API u32 SwizzledImageSize(u32 width, u32 height, u32 depth, u32 mipmaps,
+                                u32 fmt, u32 tile_width_spacing, u32 block_height);
+YKCMP_API u32 UnswizzledArraySize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers, u32 fmt);
+YKCMP_API u32 SwizzledArraySize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                                u32 fmt, u32 tile_width_spacing, u32 block_height);
+/// Whether the parameters describe a texture the functions here can handle: a known format, no
+/// zero extents, 1-15 mip levels, block_height and tile_width_spacing in hardware range, and
+/// linear, block-linear and decoded sizes that all fit in 31 bits. The size functions work in u32
+/// and wrap otherwise, so check any shape read from a file or passed in by a user first.
+YKCMP_API bool IsValidImageShape(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                                 u32 fmt, u32 tile_width_spacing, u32 block_height);
+
+/// Unswizzles and decodes a texture in one pass into RGBA8 (RGBA16F for BC6H, RGBA32F for
+/// uncompressed formats wider than 8 bits per channel), laid out like the array functions' linear
+/// output. Returns false for formats without a decoder.
+/// Size dst with DecodedImageSize, which returns 0 for those formats.
+YKCMP_API bool DecodeImage(u8* src, u8* dst,
+                           u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                           u32 fmt, u32 tile_width_spacing, u32 block_height, u32 num_threads);
+/// DecodeImage for data that is already linear, laid out like UnswizzleImageArray's output.
+YKCMP_API bool DecodeLinearImage(u8* src, u8* dst,
+                                 u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                                 u32 fmt, u32 num_threads);
+YKCMP_API u32 DecodedImageSize(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers, u32 fmt);
+/// Encodes RGBA8 pixels, laid out like DecodeImage's output, into a block-linear BC1-BC5 or BC7
+/// texture of the given shape; size dst with SwizzledArraySize. quality runs from 0 (fastest) to
+/// 2 (smallest error) and only changes BC7 much. Returns false for formats without an encoder.
+YKCMP_API bool EncodeImage(u8* src, u8* dst,
+                           u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                           u32 fmt, u32 tile_width_spacing, u32 block_height, u32 quality, u32 num_threads);
+
+/// A texture's level layout and work split, computed once and run against any number of images
+/// with the same parameters. The image functions above already fetch plans from a cache of the
+/// 256 most recently used shapes; these are for callers that want to hold on to one.
+struct SwizzlePlan;
+YKCMP_API SwizzlePlan* CreateSwizzlePlan(u32 width, u32 height, u32 depth, u32 mipmaps, u32 layers,
+                                         u32 fmt, u32 tile_width_spacing, u32 block_height);
+YKCMP_API void DestroySwizzlePlan(SwizzlePlan* plan);
+YKCMP_API void UnswizzleWithPlan(const SwizzlePlan* plan, u8* src, u8* dst, u32 num_threads);
+YKCMP_API void SwizzleWithPlan(const SwizzlePlan* plan, u8* src, u8* dst, u32 num_threads);
+YKCMP_API u32 SwizzlePlanUnswizzledSize(const SwizzlePlan* plan);
+YKCMP_API u32 SwizzlePlanSwizzledSize(const SwizzlePlan* plan);
+
+/// Resizes the plan cache, evicting the least recently used plans; 0 disables caching.
+YKCMP_API void SetSwizzlePlanCacheSize(u32 capacity);
+
+/// Instruction set the whole-GOB kernels were picked for: "avx512", "avx2" or "sector".
+YKCMP_API const char* SwizzleKernelName();
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "swizzle_simd.h"
+#include "swizzle.h"
+
+#if !defined(SWIZZLE_FORCE_SCALAR) && (defined(_M_X64) || defined(__x86_64__))
+#define SWIZZLE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SWIZZLE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SWIZZLE_TARGET(isa)
+#endif
+
+// Inside a GOB, line y's sector s lives at SWIZZLE_TABLE[y][s * 16]: sector pairs are 256 bytes
+// apart, line pairs 64, sectors within a pair 32 and lines within a pair 16. So 64 contiguous
+// swizzled bytes hold sectors 2h and 2h+1 of two neighbouring lines, interleaved line by line.
+
+/// Sector at a time. 16-byte copies already compile to SSE2 moves on x86-64 and q-register
+/// moves on AArch64, so this is the baseline everywhere.
+static void UnswizzleGobSector(u8* linear, u32 pitch, const u8* gob) {
+    for (u32 y = 0; y < GOB_SIZE_Y; ++y) {
+        for (u32 x = 0; x < GOB_SIZE_X; x += GOB_SECTOR_SIZE) {
+            std::memcpy(linear + y * pitch + x, gob + SWIZZLE_TABLE[y][x], GOB_SECTOR_SIZE);
+        }
+    }
+}
+
+static void SwizzleGobSector(u8* gob, const u8* linear, u32 pitch) {
+    for (u32 y = 0; y < GOB_SIZE_Y; ++y) {
+        for (u32 x = 0; x < GOB_SIZE_X; x += GOB_SECTOR_SIZE) {
+            std::memcpy(gob + SWIZZLE_TABLE[y][x], linear + y * pitch + x, GOB_SECTOR_SIZE);
+        }
+    }
+}
+
+#ifdef SWIZZLE_X86
+
+/// Half a line pair per iteration: two 32-byte swizzled loads hold [A0 B0] and [A1 B1], and a
+/// 128-bit lane permute turns them into the 32-byte runs [A0 A1] and [B0 B1] of lines A and B.
+SWIZZLE_TARGET("avx2")
+static void UnswizzleGobAVX2(u8* linear, u32 pitch, const u8* gob) {
+    for (u32 y = 0; y < GOB_SIZE_Y; y += 2) {
+        u8* line_a = linear + y * pitch;
+        u8* line_b = line_a + pitch;
+        for (u32 x = 0; x < GOB_SIZE_X; x += 32) {
+            const u8* src = gob + SWIZZLE_TABLE[y][x];
+            const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+            const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(line_a + x), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(line_b + x), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+    }
+}
+
+/// The lane permute is its own inverse, so swizzling is the same shuffle in the other direction.
+SWIZZLE_TARGET("avx2")
+static void SwizzleGobAVX2(u8* gob, const u8* linear, u32 pitch) {
+    for (u32 y = 0; y < GOB_SIZE_Y; y += 2) {
+        const u8* line_a = linear + y * pitch;
+        const u8* line_b = line_a + pitch;
+        for (u32 x = 0; x < GOB_SIZE_X; x += 32) {
+            u8* dst = gob + SWIZZLE_TABLE[y][x];
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line_a + x));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line_b + x));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+    }
+}
+
+/// A full line pair per iteration: the 64 bytes at +0 and +256 hold [A0 B0 A1 B1] and
+/// [A2 B2 A3 B3], and a two-source qword permute gathers each line's four sectors.
+SWIZZLE_TARGET("avx512f")
+static void UnswizzleGobAVX512(u8* linear, u32 pitch, const u8* gob) {
+    const __m512i even = _mm512_setr_epi64(0, 1, 4, 5, 8, 9, 12, 13);
+    const __m512i odd = _mm512_setr_epi64(2, 3, 6, 7, 10, 11, 14, 15);
+    for (u32 y = 0; y < GOB_SIZE_Y; y += 2) {
+        const u8* src = gob + SWIZZLE_TABLE[y][0];
+        const __m512i lo = _mm512_loadu_si512(src);
+        const __m512i hi = _mm512_loadu_si512(src + 256);
+        _mm512_storeu_si512(linear + y * pitch, _mm512_permutex2var_epi64(lo, even, hi));
+        _mm512_storeu_si512(linear + (y + 1) * pitch, _mm512_permutex2var_epi64(lo, odd, hi));
+    }
+}
+
+SWIZZLE_TARGET("avx512f")
+static void SwizzleGobAVX512(u8* gob, const u8* linear, u32 pitch) {
+    const __m512i low_sectors = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+    const __m512i high_sectors = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+    for (u32 y = 0; y < GOB_SIZE_Y; y += 2) {
+        u8* dst = gob + SWIZZLE_TABLE[y][0];
+        const __m512i a = _mm512_loadu_si512(linear + y * pitch);
+        const __m512i b = _mm512_loadu_si512(linear + (y + 1) * pitch);
+        _mm512_storeu_si512(dst, _mm512_permutex2var_epi64(a, low_sectors, b));
+        _mm512_storeu_si512(dst + 256, _mm512_permutex2var_epi64(a, high_sectors, b));
+    }
+}
+
+/// CPUID alone isn't enough: the OS must also save the wider registers on a context switch,
+/// which XCR0 reports. GCC and Clang's builtins check both.
+static bool HasAVX2() {
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool HasAVX512() {
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0xE6) != 0xE6) return false;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 16)) != 0;
+#else
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+#endif // SWIZZLE_X86
+
+static GobKernels SelectGobKernels() {
+#ifdef SWIZZLE_X86
+    if (HasAVX512()) return {UnswizzleGobAVX512, SwizzleGobAVX512, "avx512"};
+    if (HasAVX2()) return {UnswizzleGobAVX2, SwizzleGobAVX2, "avx2"};
+#endif
+    return {UnswizzleGobSector, SwizzleGobSector, "sector"};
+}
+
+const GobKernels& GetGobKernels() {
+    static const GobKernels kernels = SelectGobKernels();
+    return kernels;
+}
+
+extern "C" YKCMP_API
+const char* SwizzleKernelName() {
+    return GetGobKernels().name;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Util.h"
+
+/* SWIZZLE_FORCE_SCALAR
+ * Define this to skip CPU feature detection and always use the portable GOB kernels, e.g. to
+ * rule the vector paths out when chasing a mismatch.
+ */
+
+/// Copies one whole 512-byte GOB between block-linear and linear layout. linear points at the
+/// GOB's top-left byte and pitch is the linear line length in bytes.
+using UnswizzleGobFn = void (*)(u8* linear, u32 pitch, const u8* gob);
+using SwizzleGobFn = void (*)(u8* gob, const u8* linear, u32 pitch);
+
+struct GobKernels {
+    UnswizzleGobFn unswizzle;
+    SwizzleGobFn swizzle;
+    const char* name;
+};
+
+/// Kernels for the best instruction set the CPU supports, chosen once on first use.
+const GobKernels& GetGobKernels();
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include "swizzle.h"
+#include "texture.h"
+#include "ykcmp.h"
+
+// PixelFormat index + 1 for each type byte, 0 while unmapped.
+static std::array<std::atomic<u32>, 256> texture_formats{};
+
+extern "C" YKCMP_API
+bool SetTextureFormat(u32 type, u32 fmt) {
+    if (type >= texture_formats.size() || fmt > MaxPixelFormat) return false;
+    texture_formats[type].store(fmt == MaxPixelFormat ? 0 : fmt + 1, std::memory_order_relaxed);
+    return true;
+}
+
+static bool IsCompressed(const u8* data, u32 size) {
+    return size >= sizeof(YKCMP_HDR) && std::memcmp(data, YKCMP_MAGIC, sizeof(YKCMP_MAGIC)) == 0;
+}
+
+/// Reads the header from the start of the file, expanding just enough of it when the whole file is
+/// compressed.
+static s32 ReadTextureHeader(const u8* in, u32 in_size, TEX_HDR& hdr) {
+    if (IsCompressed(in, in_size)) {
+        const s32 written = decompress_prefix(in, in_size, reinterpret_cast<u8*>(&hdr), sizeof(TEX_HDR));
+        if (written < 0) return written;
+        return written == sizeof(TEX_HDR) ? YKCMP_OK : YKCMP_ERROR_TRUNCATED;
+    }
+    if (in_size < sizeof(TEX_HDR)) return YKCMP_ERROR_HEADER;
+    std::memcpy(&hdr, in, sizeof(TEX_HDR));
+    return YKCMP_OK;
+}
+
+/// A texture file's header, checked, and where its image is.
+struct TextureInfo {
+    TEX_HDR hdr;
+    u32 fmt;
+    u32 mipmaps;
+    const u8* image;
+    u32 image_size;
+    bool compressed;   ///< The image is a YKCMP blob, unswizzled as it decompresses
+    u32 image_offset;  ///< Bytes before the image in the blob's decompressed data
+};
+
+/// Reads and checks the header, then checks that the data holds an image of the shape it gives. The
+/// image is stored after the header or inside a YKCMP blob, which is the whole file or follows the
+/// header.
+static s32 ParseTexture(const u8* in, u32 in_size, TextureInfo& info) {
+    TEX_HDR& hdr = info.hdr;
+    if (const s32 status = ReadTextureHeader(in, in_size, hdr); status < 0) return status;
+
+    const u32 mapped = texture_formats[hdr.type].load(std::memory_order_relaxed);
+    if (mapped == 0 || hdr.width > TEX_MAX_DIMENSION || hdr.height > TEX_MAX_DIMENSION) {
+        return YKCMP_ERROR_FORMAT;
+    }
+    info.fmt = mapped - 1;
+    info.mipmaps = std::max<u32>(hdr.mipmaps, 1);
+    // Headers come straight from the file: a wild block height or a wide format at the maximum
+    // dimensions would otherwise shift out of range or wrap the u32 sizes below.
+    if (!IsValidImageShape(hdr.width, hdr.height, 1, info.mipmaps, 1, info.fmt, hdr.tile_spacing,
+                           hdr.block_height)) {
+        return YKCMP_ERROR_FORMAT;
+    }
+
+    const bool whole_file = IsCompressed(in, in_size);
+    info.image = whole_file ? in : in + sizeof(TEX_HDR);
+    info.image_size = whole_file ? in_size : in_size - u32{sizeof(TEX_HDR)};
+    info.compressed = whole_file || IsCompressed(info.image, info.image_size);
+    info.image_offset = whole_file ? u32{sizeof(TEX_HDR)} : 0;
+
+    u32 available = info.image_size;
+    if (info.compressed) {
+        YKCMP_HDR blob{};
+        std::memcpy(&blob, info.image, sizeof(YKCMP_HDR));
+        available = blob.decompSize < info.image_offset ? 0 : blob.decompSize - info.image_offset;
+    }
+    const u32 swizzled_size = SwizzledArraySize(hdr.width, hdr.height, 1, info.mipmaps, 1, info.fmt,
+                                                hdr.tile_spacing, hdr.block_height);
+    return available < swizzled_size ? YKCMP_ERROR_SIZE_MISMATCH : YKCMP_OK;
+}
+
+extern "C" YKCMP_API
+bool IsTexture(const u8* in, u32 in_size) {
+    TextureInfo info;
+    return ParseTexture(in, in_size, info) == YKCMP_OK;
+}
+
+extern "C" YKCMP_API
+s32 LoadTexture(const u8* in, u32 in_size, u8* out, u32 out_cap) {
+    TextureInfo info;
+    if (const s32 status = ParseTexture(in, in_size, info); status < 0) return status;
+    const TEX_HDR& hdr = info.hdr;
+
+    const u32 linear_size = UnswizzledArraySize(hdr.width, hdr.height, 1, info.mipmaps, 1, info.fmt);
+    if (!out) return static_cast<s32>(linear_size);
+    if (out_cap < linear_size) return YKCMP_ERROR_OUTPUT_OVERRUN;
+
+    if (info.compressed) {
+        const s32 status = DecompressUnswizzleImage(info.image, info.image_size, info.image_offset, out, hdr.width,
+                                                    hdr.height, 1, info.mipmaps, 1, info.fmt, hdr.tile_spacing,
+                                                    hdr.block_height);
+        if (status < 0) return status;
+    } else {
+        UnswizzleImageArray(const_cast<u8*>(info.image), out, hdr.width, hdr.height, 1, info.mipmaps, 1, info.fmt,
+                            hdr.tile_spacing, hdr.block_height, 1);
+    }
+    return static_cast<s32>(linear_size);
+}
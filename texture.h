@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Util.h"
+
+/// Header of a texture file. The swizzled image follows it, either stored as is or as a YKCMP blob;
+/// some files are instead one YKCMP blob that expands to the header and the image together.
+struct TEX_HDR {
+    uint8_t magic[8];
+    uint8_t unk_08[8];
+    uint8_t unk_10[4];
+    uint8_t type;
+    uint8_t unk_15[1];
+    uint8_t unk_16[2];
+    uint32_t width;
+    uint32_t height;
+    uint8_t unk_20[2];
+    uint8_t unk_22[2];
+    uint8_t unk_24[1];
+    uint8_t mipmaps;
+    uint8_t unk_26[1];
+    uint8_t unk_27[5];
+    uint32_t decompSize;
+    uint32_t compSize;
+    uint8_t unk_34[4];
+    uint8_t block_height;
+    uint8_t tile_spacing;
+    uint8_t unk_3A[2];
+    uint8_t unk_3C[2];
+    uint8_t unk_3E[2];
+    uint8_t pad_40[0x40];
+};
+static_assert(sizeof(TEX_HDR) == 0x80);
+
+/// Largest width or height LoadTexture accepts, the GPU's own limit.
+constexpr u32 TEX_MAX_DIMENSION = 16384;
+
+extern "C" {
+/// Maps a TEX_HDR type byte to a PixelFormat index for LoadTexture. The codes differ between games,
+/// so nothing is mapped until the caller registers them; MaxPixelFormat removes a mapping. Returns
+/// false for an out of range format.
+YKCMP_API bool SetTextureFormat(u32 type, u32 fmt);
+
+/// Parses a texture file, decompresses it if needed and unswizzles every mip level into out in one
+/// call on the calling thread. Returns the number of bytes written, or a negative YKCMPError:
+/// YKCMP_ERROR_FORMAT for an unmapped type or an impossible shape, YKCMP_ERROR_SIZE_MISMATCH when the
+/// image is smaller than its shape needs and YKCMP_ERROR_OUTPUT_OVERRUN when out_cap is too small.
+/// With out set to nullptr only the header is read and the size out needs is returned.
+YKCMP_API s32 LoadTexture(const u8* in, u32 in_size, u8* out, u32 out_cap);
+
+/// Whether in starts with a TEX_HDR that LoadTexture accepts: a mapped type, a valid shape and
+/// enough data behind it for the image. Only the header is read, so this is cheap enough to sort
+/// textures from other data; the image itself may still turn out to be corrupt.
+YKCMP_API bool IsTexture(const u8* in, u32 in_size);
+}
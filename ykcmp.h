@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Util.h"
+
+constexpr char YKCMP_MAGIC[8] = {'Y', 'K', 'C', 'M', 'P', '_', 'V', '1'};
+
+struct YKCMP_HDR {
+    char magic[8];
+    u32 compType;
+    u32 compSize;
+    u32 decompSize;
+};
+static_assert(sizeof(YKCMP_HDR) == 0x14);
+
+/// Status codes returned by the checked decoders. Everything below YKCMP_OK is a failure.
+enum YKCMPError : s32 {
+    YKCMP_OK = 0,
+    YKCMP_ERROR_HEADER = -1,          ///< Input is smaller than the header or has the wrong magic
+    YKCMP_ERROR_TYPE = -2,            ///< Unsupported compression type
+    YKCMP_ERROR_SIZE_MISMATCH = -3,   ///< Output size differs from the header's decompSize
+    YKCMP_ERROR_INPUT_OVERRUN = -4,   ///< A token reads past the end of the input
+    YKCMP_ERROR_OUTPUT_OVERRUN = -5,  ///< A token writes past the end of the output
+    YKCMP_ERROR_OFFSET = -6,          ///< A back-reference points before the start of the output
+    YKCMP_ERROR_TRUNCATED = -7,       ///< Input ended before the output was filled
+    YKCMP_ERROR_LZ4 = -8,             ///< LZ4 rejected the payload
+    YKCMP_ERROR_FORMAT = -9,          ///< Texture type has no PixelFormat or its shape is invalid
+};
+
+// Type 4 token grammar. A control byte below 0x80 is a literal run of that many bytes; above it
+// are three back-reference forms of increasing reach:
+//   0x80-0xBF: 1 byte,  size 1-4,   offset 1-16
+//   0xC0-0xDF: 2 bytes, size 2-33,  offset 1-256
+//   0xE0-0xFF: 3 bytes, size 3-514, offset 1-4096
+constexpr u32 TYPE4_MAX_LITERAL = 0x7F;
+constexpr u32 TYPE4_MAX_SHORT_OFFSET = 16;
+constexpr u32 TYPE4_MAX_SHORT_MATCH = 4;
+constexpr u32 TYPE4_MAX_MEDIUM_OFFSET = 256;
+constexpr u32 TYPE4_MIN_MEDIUM_MATCH = 2;
+constexpr u32 TYPE4_MAX_MEDIUM_MATCH = 33;
+constexpr u32 TYPE4_MIN_MATCH = 3;
+constexpr u32 TYPE4_MAX_MATCH = 0x1FF + 3;
+constexpr u32 TYPE4_WINDOW_SIZE = 0x1000;
+
+/// Compression levels accepted by compress: 0 stores literals only, higher levels search harder and
+/// the last one runs a minimum-size optimal parse.
+constexpr s32 TYPE4_LEVEL_OPTIMAL = 10;
+constexpr s32 TYPE4_MAX_LEVEL = TYPE4_LEVEL_OPTIMAL;
+
+/// Number of bytes following a type 4 control byte: literal data is counted separately, so this is
+/// only the offset/size bytes of the 0xC0 and 0xE0 match forms.
+[[nodiscard]] constexpr u32 Type4ExtraBytes(u8 control) {
+    return control >= 0xE0 ? 2 : control >= 0xC0 ? 1 : 0;
+}
+
+/// Decodes the back-reference described by a control byte >= 0x80, reading any extra bytes from fd.
+inline void DecodeType4Match(u8 control, const u8* fd, size_t& inPos, u32& offset, u32& size) {
+    if (control < 0xC0) {
+        offset = (control & 0xF) + 1;
+        size = (control >> 4) - 8 + 1;
+    } else if (control < 0xE0) {
+        offset = fd[inPos++] + 1;
+        size = control - 0xC0 + 2;
+    } else {
+        u8 temp = fd[inPos++];
+        u8 temp2 = fd[inPos++];
+        size = (control << 4) + (temp >> 4) - 0xE00 + 3;
+        offset = ((temp & 0xF) << 8) + temp2 + 1;
+    }
+}
+
+/// One buffer of a decompress_batch call; the fields match decompress_safe's arguments.
+struct YKCMPBatchItem {
+    const u8* in;
+    u32 in_size;
+    u8* out;
+    u32 out_size;
+};
+
+/// Incremental decoder state, see decompress_stream_init.
+struct YKCMPStream;
+
+extern "C" {
+YKCMP_API bool decompress(u8* fd, u32 in_size, u8* out, u32 out_size);
+YKCMP_API s32 decompress_safe(const u8* fd, u32 in_size, u8* out, u32 out_size);
+
+/// Decodes only the first want_bytes bytes of the output (or all of it if decompSize is smaller)
+/// and stops. Returns the number of bytes written or a negative YKCMPError.
+YKCMP_API s32 decompress_prefix(const u8* fd, u32 in_size, u8* out, u32 want_bytes);
+
+/// Decompresses count independent buffers on num_threads threads (0 uses every core), largest
+/// first. status, if not null, receives each item's decompress_safe result. Returns how many items
+/// failed.
+YKCMP_API u32 decompress_batch(const YKCMPBatchItem* items, u32 count, u32 num_threads, s32* status);
+
+/// Worst-case output size of compress for in_size input bytes.
+YKCMP_API u32 compress_bound(u32 in_size);
+
+/// Compresses in as a type 4 YKCMP blob, header included. Returns the number of bytes written or a
+/// negative YKCMPError (YKCMP_ERROR_OUTPUT_OVERRUN if out_cap is too small).
+YKCMP_API s32 compress(const u8* in, u32 in_size, u8* out, u32 out_cap, s32 level);
+
+/// Streaming decoder. Feed compressed bytes in arbitrary chunks (the header included) and drain the
+/// decoded bytes as they become available; only a small history window is kept in memory.
+/// feed returns how many input bytes were consumed, which is less than in_size once the internal
+/// buffer is full of undrained output, or a negative YKCMPError. finish returns the final status
+/// and releases the stream.
+YKCMP_API YKCMPStream* decompress_stream_init();
+YKCMP_API s32 decompress_stream_feed(YKCMPStream* stream, const u8* in, u32 in_size);
+YKCMP_API u32 decompress_stream_drain(YKCMPStream* stream, u8* out, u32 out_size);
+YKCMP_API s32 decompress_stream_finish(YKCMPStream* stream);
+}